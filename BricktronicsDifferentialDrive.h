@@ -0,0 +1,360 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSDIFFERENTIALDRIVE_H
+#define BRICKTRONICSDIFFERENTIALDRIVE_H
+
+// A rover with a motor driving a wheel on each side.
+//
+// Odometry: every update(), both encoders are read together and the rover's
+// position (x, y) and heading are moved along by how far each wheel turned.
+// It's all integer math, so it's quick enough to keep up with every
+// update(), and no wheel movement is missed between samples. Distances are
+// in encoder ticks of wheel travel (720 ticks per wheel revolution), and the
+// track width (the distance between the two wheels) has to be given in the
+// same units. The heading doesn't add up small steps, it's worked out from
+// the total difference between the wheels, so it doesn't drift on its own.
+//
+// Driving: drive() runs both motors with their speed loops, at the wheel
+// speeds for a given linear and angular speed. The speed loops alone let
+// the rover wander off course when one wheel drags more than the other, so
+// the drive also keeps track of where the difference between the wheels
+// should be by now, and nudges the wheel speeds apart to get it there.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsMotor.h"
+#include "utility/BricktronicsTrig.h"
+
+// How often the drive checks the heading and updates the wheel speeds
+#define BRICKTRONICS_DRIVE_SAMPLE_TIME_MS                   10
+
+// Default heading gain: wheel speed difference (ticks per second) per tick
+// of heading error (the difference between the wheels)
+#define BRICKTRONICS_DRIVE_HEADING_KP                       4.0
+
+template <class Controller>
+class BricktronicsControlledDifferentialDrive
+{
+    public:
+        // The motors aren't copied, so they need to stay around (global
+        // variables are easiest). The track width is the distance between the
+        // wheels (where they touch the ground), in encoder ticks of wheel
+        // travel: trackWidth * 720 / ( pi * wheelDiameter ).
+        BricktronicsControlledDifferentialDrive(BricktronicsControlledMotor<Controller> &left, BricktronicsControlledMotor<Controller> &right, uint16_t trackWidthTicks):
+            _left(left),
+            _right(right),
+            _leftReversed(false),
+            _rightReversed(false),
+            _lastLeft(0),
+            _lastRight(0),
+            _wheelDifference(0),
+            _headingOffset(0),
+            _heading(0),
+            _x(0),
+            _y(0),
+            _driving(false),
+            _linearSpeed(0),
+            _differenceSpeed(0),
+            _targetDifference(0),
+            _targetRemainder(0),
+            _headingKpQ8(BRICKTRONICS_DRIVE_HEADING_KP * 256),
+            _sampleTimeMS(BRICKTRONICS_DRIVE_SAMPLE_TIME_MS),
+            _lastSample(0)
+        {
+            setTrackWidth(trackWidthTicks);
+        }
+
+        // Initializes both motors, and starts the odometry at (0, 0) heading
+        // along the X axis.
+        void begin(void)
+        {
+            _left.begin();
+            _right.begin();
+            setPose(0, 0, 0);
+        }
+
+        // The motors on the two sides usually face opposite ways, so one of
+        // them counts backwards when the rover drives forwards. Set that one
+        // as reversed, and everything here (odometry and speeds) is in the
+        // rover's directions: forwards is positive for both wheels.
+        void setReversed(bool leftReversed, bool rightReversed)
+        {
+            _leftReversed = leftReversed;
+            _rightReversed = rightReversed;
+            _readWheels(&_lastLeft, &_lastRight);
+        }
+
+        // Change the track width (ticks), for example after measuring how far
+        // off a few turns on the spot come out. The heading stays the same.
+        void setTrackWidth(uint16_t trackWidthTicks)
+        {
+            if( trackWidthTicks == 0 )
+            {
+                return;
+            }
+            _trackWidth = trackWidthTicks;
+            // A full turn (2^32) is a wheel difference of 2 * pi * trackWidth
+            _headingScale = lround(4294967296.0 / ( 2 * PI * trackWidthTicks ));
+            _headingOffset = _heading - (uint32_t) _wheelDifference * _headingScale;
+        }
+        uint16_t getTrackWidth(void)
+        {
+            return _trackWidth;
+        }
+
+        // Call this (instead of each motor's update()) as often as you can.
+        // It updates both motors and the odometry, and the wheel speeds every
+        // _sampleTimeMS while driving.
+        void update(void)
+        {
+            _left.update();
+            _right.update();
+            _updateOdometry();
+
+            if( !_driving )
+            {
+                return;
+            }
+            unsigned long now = millis();
+            if( now - _lastSample >= _sampleTimeMS )
+            {
+                _lastSample = now;
+                _updateDrive();
+            }
+        }
+
+        // This function periodically calls update() until delayMS
+        // milliseconds have elapsed.
+        void delayUpdateMS(uint32_t delayMS)
+        {
+            unsigned long endTime = millis() + delayMS;
+            while( millis() < endTime )
+            {
+                update();
+            }
+        }
+
+
+        // Odometry functions
+        // Sets where the rover is (ticks), and its heading (degrees,
+        // counter-clockwise from the X axis).
+        void setPose(int32_t x, int32_t y, int16_t headingDegrees)
+        {
+            _readWheels(&_lastLeft, &_lastRight);
+            _x = x * 256;
+            _y = y * 256;
+            _heading = (uint32_t) BricktronicsTrig::fromDegrees(headingDegrees) << 16;
+            _headingOffset = _heading - (uint32_t) _wheelDifference * _headingScale;
+        }
+
+        // Where the rover is, in ticks of wheel travel from where it started
+        int32_t getX(void)
+        {
+            return ( _x + 128 ) >> 8;
+        }
+        int32_t getY(void)
+        {
+            return ( _y + 128 ) >> 8;
+        }
+
+        // The rover's heading as a binary angle (65536 is a full turn, see
+        // BricktronicsTrig.h), counter-clockwise from the X axis.
+        uint16_t getHeading(void)
+        {
+            return ( _heading + 0x8000 ) >> 16;
+        }
+
+        // The rover's heading in degrees, -180 to 180.
+        int16_t getHeadingDegrees(void)
+        {
+            return BricktronicsTrig::toDegrees(getHeading());
+        }
+
+
+        // Driving functions
+        // Drives at linearSpeed (ticks per second, forwards is positive) while
+        // turning at angularSpeed (degrees per second, counter-clockwise is
+        // positive). Uses both motors' speed loops. Call it again at any time
+        // to change the speeds.
+        void drive(int16_t linearSpeed, int16_t angularSpeed)
+        {
+            if( !_driving )
+            {
+                _targetDifference = _wheelDifference;
+                _targetRemainder = 0;
+                _lastSample = millis() - _sampleTimeMS;
+                _driving = true;
+            }
+            _linearSpeed = linearSpeed;
+            // The right wheel has to go 2 * pi * trackWidth further than the
+            // left wheel for a full turn, and 71 / 4068 is pi / 180.
+            _differenceSpeed = (int32_t) angularSpeed * _trackWidth * 71 / 4068;
+        }
+
+        // Stops driving, and brakes both motors.
+        void stop(void)
+        {
+            _driving = false;
+            _left.brake();
+            _right.brake();
+        }
+
+        // Set the heading gain: how much (ticks per second) the wheel speeds
+        // are pushed apart per tick of heading error. The heading error is in
+        // ticks of difference between the wheels, trackWidth ticks of it is
+        // about 57 degrees. 0 turns the heading correction off. Defaults to 4.
+        void setHeadingGain(double Kp)
+        {
+            if( Kp >= 0 && Kp < 255 )
+            {
+                _headingKpQ8 = Kp * 256;
+            }
+        }
+        double getHeadingGain(void)
+        {
+            return _headingKpQ8 / 256.0;
+        }
+
+        // Set how often (ms) the heading is checked and the wheel speeds
+        // updated while driving. Defaults to 10.
+        void setSampleTimeMS(uint16_t sampleTimeMS)
+        {
+            if( sampleTimeMS > 0 )
+            {
+                _sampleTimeMS = sampleTimeMS;
+            }
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        BricktronicsControlledMotor<Controller> &_left;
+        BricktronicsControlledMotor<Controller> &_right;
+        bool _leftReversed, _rightReversed;
+        uint16_t _trackWidth;
+
+        // Odometry. The heading is a 32-bit binary angle, the offset plus the
+        // total wheel difference times the scale. x and y have 8 fractional
+        // bits.
+        int32_t _lastLeft, _lastRight;
+        int32_t _wheelDifference;
+        uint32_t _headingScale;
+        uint32_t _headingOffset;
+        uint32_t _heading;
+        int32_t _x, _y;
+
+        // Driving. The target wheel difference moves along at
+        // _differenceSpeed, the remainder keeps the leftover thousandths.
+        bool _driving;
+        int16_t _linearSpeed;
+        int16_t _differenceSpeed;
+        int32_t _targetDifference;
+        int32_t _targetRemainder;
+        uint16_t _headingKpQ8;
+        uint16_t _sampleTimeMS;
+        unsigned long _lastSample;
+
+        // Both wheel positions, from one snapshot, forwards positive
+        void _readWheels(int32_t *left, int32_t *right)
+        {
+            Encoder::readPair(_left._encoder, _right._encoder, left, right);
+            if( _leftReversed )
+            {
+                *left = -*left;
+            }
+            if( _rightReversed )
+            {
+                *right = -*right;
+            }
+        }
+
+        void _updateOdometry(void)
+        {
+            int32_t left, right;
+            _readWheels(&left, &right);
+            int32_t deltaLeft = left - _lastLeft;
+            int32_t deltaRight = right - _lastRight;
+            if( deltaLeft == 0 && deltaRight == 0 )
+            {
+                return;
+            }
+            _lastLeft = left;
+            _lastRight = right;
+
+            _wheelDifference += deltaRight - deltaLeft;
+            uint32_t heading = _headingOffset + (uint32_t) _wheelDifference * _headingScale;
+            // The rover moved along the heading it had halfway through the turn
+            uint16_t middle = ( _heading + (uint32_t) ( (int32_t) ( heading - _heading ) / 2 ) ) >> 16;
+            _heading = heading;
+
+            // The rover moved ( deltaLeft + deltaRight ) / 2, and x and y have
+            // 8 fractional bits, while the trig results have 15.
+            int32_t sum = deltaLeft + deltaRight;
+            _x += ( sum * BricktronicsTrig::cosine(middle) + 128 ) >> 8;
+            _y += ( sum * BricktronicsTrig::sine(middle) + 128 ) >> 8;
+        }
+
+        void _updateDrive(void)
+        {
+            _targetRemainder += (int32_t) _differenceSpeed * _sampleTimeMS;
+            _targetDifference += _targetRemainder / 1000;
+            _targetRemainder %= 1000;
+
+            // If a wheel was held back (the rover ran into something), don't
+            // let the heading error build up more than about a radian, or it
+            // spins around once it's free.
+            int32_t error = _targetDifference - _wheelDifference;
+            if( error > _trackWidth )
+            {
+                error = _trackWidth;
+                _targetDifference = _wheelDifference + error;
+            }
+            else if( error < - (int32_t) _trackWidth )
+            {
+                error = - (int32_t) _trackWidth;
+                _targetDifference = _wheelDifference + error;
+            }
+
+            int32_t difference = _differenceSpeed + ( ( error * _headingKpQ8 ) >> 8 );
+            int16_t leftSpeed = _linearSpeed - difference / 2;
+            int16_t rightSpeed = _linearSpeed + difference / 2;
+            _left.setSpeed(_leftReversed ? -leftSpeed : leftSpeed);
+            _right.setSpeed(_rightReversed ? -rightSpeed : rightSpeed);
+        }
+};
+
+// The usual drive, with motors with PID position control
+typedef BricktronicsControlledDifferentialDrive<BricktronicsPIDController> BricktronicsDifferentialDrive;
+
+#endif // #ifndef BRICKTRONICSDIFFERENTIALDRIVE_H
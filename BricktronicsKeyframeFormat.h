@@ -0,0 +1,406 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSKEYFRAMEFORMAT_H
+#define BRICKTRONICSKEYFRAMEFORMAT_H
+
+// A compact format for keyframes, for long shows that don't fit in flash,
+// and a source that reads it from a Stream (an SD card File, Serial, ...)
+// for the keyframe player.
+//
+// Most motors only move a little from one keyframe to the next, so each
+// position is stored as the change from the same motor's previous position,
+// in as few bytes as it needs. Numbers are "varints": seven bits per byte,
+// lowest bits first, with the top bit set on every byte but the last, so
+// 0 to 127 take one byte, up to 16383 two, and so on. Changes are signed, so
+// they're "zigzag" encoded first (0, -1, 1, -2, 2... become 0, 1, 2, 3, 4...)
+// to keep small negative changes small too.
+//
+// The layout is:
+//
+//   'B' 'K' 'F' version(1) motors timeBaseMS
+//
+// followed by the keyframes, each of which is:
+//
+//   duration (varint, in units of timeBaseMS, at least 1)
+//   change in position (zigzag varint) for each motor
+//
+// and then a duration of 0, which ends the show. The positions all start
+// at 0, and anything after the end is read as the next show. A keyframe for
+// 24 motors that mostly move less than 64 ticks is 25 bytes, instead of 50
+// in the table layout.
+//
+// The source reads into one half of a small double buffer as data arrives,
+// on every update(), while keyframes are decoded from the other half. It
+// never waits on the Stream: until a whole keyframe has been decoded, it
+// isn't ready(), and the player holds the motors where they are.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsKeyframePlayer.h"
+
+#define BRICKTRONICS_KEYFRAME_FORMAT_VERSION                2
+#define BRICKTRONICS_KEYFRAME_FORMAT_HEADER_SIZE            6
+
+// The most motors the format reader and writer keep track of
+#define BRICKTRONICS_KEYFRAME_FORMAT_MAX_MOTORS             32
+
+// The size of each half of the reader's double buffer
+#define BRICKTRONICS_KEYFRAME_FORMAT_BUFFER_SIZE            32
+
+// Writes keyframes in the compact format, to anything you can print to (an
+// SD card File, Serial, ...).
+class BricktronicsKeyframeWriter
+{
+    public:
+        // The output is not copied, so it needs to stay around (a global
+        // variable is easiest).
+        BricktronicsKeyframeWriter(Print &output):
+            _output(output),
+            _motors(0),
+            _timeBaseMS(1),
+            _remainderMS(0)
+        {
+        }
+
+        // Writes the header. Durations are stored in units of timeBaseMS
+        // (rounded, but the rounding doesn't add up over the show), so a
+        // larger time base can save a byte per keyframe. Returns false if
+        // there are too many motors.
+        bool begin(uint8_t motors, uint8_t timeBaseMS)
+        {
+            if( motors > BRICKTRONICS_KEYFRAME_FORMAT_MAX_MOTORS || timeBaseMS == 0 )
+            {
+                return false;
+            }
+            _motors = motors;
+            _timeBaseMS = timeBaseMS;
+            _remainderMS = 0;
+            for( uint8_t i = 0; i < _motors; i++ )
+            {
+                _positions[i] = 0;
+            }
+            uint8_t header[BRICKTRONICS_KEYFRAME_FORMAT_HEADER_SIZE] = { 'B', 'K', 'F', BRICKTRONICS_KEYFRAME_FORMAT_VERSION, motors, timeBaseMS };
+            _output.write(header, BRICKTRONICS_KEYFRAME_FORMAT_HEADER_SIZE);
+            return true;
+        }
+
+        // Writes a keyframe: how long (ms) after the previous one it is, and
+        // a position for each motor. Returns the number of bytes written.
+        uint16_t writeKeyframe(uint16_t durationMS, const int16_t *positions)
+        {
+            int32_t time = (int32_t) durationMS + _remainderMS;
+            uint32_t units = time > 0 ? ( time + _timeBaseMS / 2 ) / _timeBaseMS : 0;
+            if( units == 0 )
+            {
+                // A duration of 0 ends the show
+                units = 1;
+            }
+            _remainderMS = time - (int32_t) units * _timeBaseMS;
+            if( _remainderMS < -_timeBaseMS )
+            {
+                // Keyframes closer together than the time base run a little
+                // slow, rather than owing time to the ones after them
+                _remainderMS = -_timeBaseMS;
+            }
+            uint16_t written = _writeVarint(units);
+            for( uint8_t i = 0; i < _motors; i++ )
+            {
+                // The change wraps around like the positions do, so it always
+                // fits in 16 bits.
+                int16_t change = (uint16_t) positions[i] - (uint16_t) _positions[i];
+                _positions[i] = positions[i];
+                uint16_t zigzag = ( (uint16_t) change << 1 ) ^ (uint16_t) ( change >> 15 );
+                written += _writeVarint(zigzag);
+            }
+            return written;
+        }
+
+        // Ends the show. Another one can be written after it, starting with
+        // begin().
+        void end(void)
+        {
+            _writeVarint(0);
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        Print &_output;
+        uint8_t _motors;
+        uint8_t _timeBaseMS;
+        // Rounding left over from the last duration (can be negative)
+        int16_t _remainderMS;
+        int16_t _positions[BRICKTRONICS_KEYFRAME_FORMAT_MAX_MOTORS];
+
+        uint8_t _writeVarint(uint32_t value)
+        {
+            uint8_t written = 0;
+            while( value >= 0x80 )
+            {
+                _output.write((uint8_t) ( value | 0x80 ));
+                value >>= 7;
+                written++;
+            }
+            _output.write((uint8_t) value);
+            return written + 1;
+        }
+};
+
+// Reads keyframes in the compact format from a Stream, for the keyframe
+// player. The next keyframe is decoded as its bytes arrive, into the
+// positions readPosition() returns, so the player has to read the positions
+// right after readDuration(), before the next poll().
+class BricktronicsCompactKeyframes : public BricktronicsKeyframeSource
+{
+    public:
+        // The stream is not copied, so it needs to stay around (a global
+        // variable is easiest).
+        BricktronicsCompactKeyframes(Stream &stream):
+            _stream(stream),
+            _motors(0),
+            _timeBaseMS(0),
+            _motor(0),
+            _field(0),
+            _varint(0),
+            _shift(0),
+            _ready(false),
+            _ended(false),
+            _front(0),
+            _frontIndex(0),
+            _frontCount(0),
+            _backCount(0)
+        {
+        }
+
+        // The number of motors and the time base from the header. The time
+        // base is 0 until the header has been read, and after the show ends.
+        uint8_t getMotors(void)
+        {
+            return _motors;
+        }
+        uint8_t getTimeBaseMS(void)
+        {
+            return _timeBaseMS;
+        }
+
+        bool ready(void)
+        {
+            poll();
+            return _ready;
+        }
+
+        bool readDuration(uint16_t *durationMS)
+        {
+            if( !_ready || _ended )
+            {
+                // The end of the show (or it isn't ready, which shouldn't
+                // happen). Anything after the end is a new show, starting
+                // with its header.
+                if( _ended )
+                {
+                    _timeBaseMS = 0;
+                    _field = 0;
+                    _ready = false;
+                    _ended = false;
+                }
+                return false;
+            }
+            *durationMS = _durationMS;
+            _motor = 0;
+            // Start decoding the next keyframe
+            _ready = false;
+            return true;
+        }
+
+        int16_t readPosition(void)
+        {
+            // If the player has more motors than the show, the rest stay at 0
+            if( _motor >= _motors )
+            {
+                return 0;
+            }
+            return _positions[_motor++];
+        }
+
+        // Moves whatever has arrived on the stream into the back half of the
+        // buffer, and decodes as much of the next keyframe as it can, without
+        // waiting. The player calls this on every update().
+        void poll(void)
+        {
+            uint8_t *back = _buffers[_front ^ 1];
+            int available = _stream.available();
+            while( available > 0 && _backCount < BRICKTRONICS_KEYFRAME_FORMAT_BUFFER_SIZE )
+            {
+                back[_backCount++] = _stream.read();
+                available--;
+            }
+            _decode();
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        Stream &_stream;
+        uint8_t _motors;
+        uint8_t _timeBaseMS;
+        // The next motor readPosition() will read
+        uint8_t _motor;
+        int16_t _positions[BRICKTRONICS_KEYFRAME_FORMAT_MAX_MOTORS];
+
+        // Decoding state: the header byte (while _timeBaseMS is 0) or the
+        // keyframe field (0 for the duration, then 1 for each motor) we're
+        // in, and the varint so far.
+        uint8_t _field;
+        uint32_t _varint;
+        uint8_t _shift;
+        uint16_t _durationMS;
+        uint8_t _header[BRICKTRONICS_KEYFRAME_FORMAT_HEADER_SIZE];
+        // Set when a whole keyframe (or the end of the show) has been decoded
+        bool _ready;
+        bool _ended;
+
+        // Keyframes are decoded from the front half, while poll() fills the
+        // back half. They swap when the front half is used up.
+        uint8_t _buffers[2][BRICKTRONICS_KEYFRAME_FORMAT_BUFFER_SIZE];
+        uint8_t _front;
+        uint8_t _frontIndex, _frontCount;
+        uint8_t _backCount;
+
+        // Returns false if there's nothing left in the buffer
+        bool _readByte(uint8_t *value)
+        {
+            if( _frontIndex == _frontCount )
+            {
+                if( _backCount == 0 )
+                {
+                    return false;
+                }
+                _front ^= 1;
+                _frontIndex = 0;
+                _frontCount = _backCount;
+                _backCount = 0;
+            }
+            *value = _buffers[_front][_frontIndex++];
+            return true;
+        }
+
+        // Decodes the buffered bytes until the next keyframe is ready
+        void _decode(void)
+        {
+            uint8_t byte;
+            while( !_ready && _readByte(&byte) )
+            {
+                if( _timeBaseMS == 0 )
+                {
+                    _header[_field++] = byte;
+                    if( _field == BRICKTRONICS_KEYFRAME_FORMAT_HEADER_SIZE )
+                    {
+                        _startShow();
+                    }
+                    continue;
+                }
+                if( _shift > 28 )
+                {
+                    // Not a varint, so give up on this show
+                    _endShow();
+                    return;
+                }
+                _varint |= (uint32_t) ( byte & 0x7F ) << _shift;
+                _shift += 7;
+                if( byte & 0x80 )
+                {
+                    continue;
+                }
+                if( _field == 0 )
+                {
+                    if( _varint == 0 )
+                    {
+                        _endShow();
+                        return;
+                    }
+                    uint32_t time = _varint * _timeBaseMS;
+                    _durationMS = time > 65535 ? 65535 : time;
+                }
+                else
+                {
+                    int16_t change = (uint16_t) ( _varint >> 1 ) ^ - (uint16_t) ( _varint & 1 );
+                    _positions[_field - 1] = (uint16_t) _positions[_field - 1] + (uint16_t) change;
+                }
+                _varint = 0;
+                _shift = 0;
+                if( _field == _motors )
+                {
+                    _field = 0;
+                    _ready = true;
+                }
+                else
+                {
+                    _field++;
+                }
+            }
+        }
+
+        // Checks the header, and starts the show from 0
+        void _startShow(void)
+        {
+            _field = 0;
+            _varint = 0;
+            _shift = 0;
+            if(    _header[0] != 'B' || _header[1] != 'K' || _header[2] != 'F'
+                || _header[3] != BRICKTRONICS_KEYFRAME_FORMAT_VERSION
+                || _header[4] > BRICKTRONICS_KEYFRAME_FORMAT_MAX_MOTORS
+                || _header[5] == 0 )
+            {
+                _endShow();
+                return;
+            }
+            _motors = _header[4];
+            _timeBaseMS = _header[5];
+            for( uint8_t i = 0; i < _motors; i++ )
+            {
+                _positions[i] = 0;
+            }
+        }
+
+        // The next readDuration() returns false, and then decoding starts
+        // over with the next show's header
+        void _endShow(void)
+        {
+            _ready = true;
+            _ended = true;
+        }
+};
+
+#endif // #ifndef BRICKTRONICSKEYFRAMEFORMAT_H
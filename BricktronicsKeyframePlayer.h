@@ -0,0 +1,475 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSKEYFRAMEPLAYER_H
+#define BRICKTRONICSKEYFRAMEPLAYER_H
+
+// Plays back keyframes (a position for every motor, some time apart) on any
+// number of motors at once, like the axes of an animatronic figure.
+//
+// Between keyframes, each motor follows a smooth curve (a cubic) that passes
+// through every keyframe, with the speed at each keyframe set by the
+// keyframes on either side of it. The motors start and end at rest.
+//
+// Working out a cubic at every sample would take several multiplications per
+// motor, so the player uses forward differencing instead: at the start of
+// each segment it works out how much the position changes from one sample to
+// the next, how much that changes, and how much that changes (which is the
+// same for the whole segment, for a cubic). Each sample is then three
+// additions per motor. These are 64-bit numbers with 32 fractional bits, so
+// they don't drift, and each segment starts over from its keyframes anyway.
+// The samples don't have to line up with the keyframes, so keyframes can be
+// any number of milliseconds apart and the motors still get there on time.
+//
+// The keyframes come from a source, read one at a time as they're needed:
+// a table in flash (PROGMEM), or a Stream (like an SD card File, or Serial).
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+#include "BricktronicsMotor.h"
+
+// How often the player moves the motors along their curves
+#define BRICKTRONICS_KEYFRAME_SAMPLE_TIME_MS                10
+
+// Where the keyframes come from. A keyframe is how long (ms) after the
+// previous keyframe it is, followed by a position for each motor.
+class BricktronicsKeyframeSource
+{
+    public:
+        // Starts reading the next keyframe, and returns how long after the
+        // previous one it is. Returns false at the end of the keyframes.
+        virtual bool readDuration(uint16_t *durationMS) = 0;
+
+        // Then this is called once for each motor, in order.
+        virtual int16_t readPosition(void) = 0;
+
+        // Goes back to the first keyframe, for looping. Returns false if it
+        // can't.
+        virtual bool rewind(void)
+        {
+            return false;
+        }
+
+        // Called on every update() while playing, so a source can read ahead
+        // from something slow without holding up the motors.
+        virtual void poll(void)
+        {
+        }
+
+        // True when the next keyframe (or the end of the keyframes) can be
+        // read without waiting. Until it is, the player holds the motors at
+        // the end of the current segment, and tries again on the next update().
+        virtual bool ready(void)
+        {
+            return true;
+        }
+};
+
+// Keyframes from a table in flash. Each keyframe is the duration followed by
+// the positions, for example, for two motors:
+//
+//   const int16_t show[] PROGMEM = {
+//       1000,  360, -180,   // 1 second after starting
+//        500,  720,    0,   // half a second after that
+//   };
+class BricktronicsProgmemKeyframes : public BricktronicsKeyframeSource
+{
+    public:
+        // The table is not copied (it's in flash). Give the number of
+        // keyframes and motors in it, not the number of values.
+        BricktronicsProgmemKeyframes(const int16_t *table, uint16_t keyframes, uint8_t motors):
+            _table(table),
+            _size((uint32_t) keyframes * ( motors + 1 )),
+            _index(0)
+        {
+        }
+
+        bool readDuration(uint16_t *durationMS)
+        {
+            if( _index >= _size )
+            {
+                return false;
+            }
+            *durationMS = pgm_read_word(&_table[_index++]);
+            return true;
+        }
+
+        int16_t readPosition(void)
+        {
+            return pgm_read_word(&_table[_index++]);
+        }
+
+        bool rewind(void)
+        {
+            _index = 0;
+            return true;
+        }
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        const int16_t *_table;
+        uint32_t _size;
+        uint32_t _index;
+};
+
+// Keyframes from a Stream, in the same layout as the table above: each value
+// is two bytes, low byte first. Reads wait for the Stream's timeout, so on
+// Serial the sender has to keep ahead of the playback.
+class BricktronicsStreamKeyframes : public BricktronicsKeyframeSource
+{
+    public:
+        // The stream is not copied, so it needs to stay around (a global
+        // variable is easiest).
+        BricktronicsStreamKeyframes(Stream &stream):
+            _stream(stream)
+        {
+        }
+
+        bool readDuration(uint16_t *durationMS)
+        {
+            uint8_t bytes[2];
+            if( _stream.readBytes((char *) bytes, 2) != 2 )
+            {
+                return false;
+            }
+            *durationMS = bytes[0] | ( (uint16_t) bytes[1] << 8 );
+            return true;
+        }
+
+        int16_t readPosition(void)
+        {
+            uint8_t bytes[2];
+            if( _stream.readBytes((char *) bytes, 2) != 2 )
+            {
+                // The keyframe was cut short
+                return 0;
+            }
+            return bytes[0] | ( (uint16_t) bytes[1] << 8 );
+        }
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        Stream &_stream;
+};
+
+// What the player keeps track of for each motor. Make an array of these,
+// one per motor, and give it to the player.
+struct BricktronicsKeyframeAxis
+{
+    // The keyframes before, at the start of, at the end of, and after the
+    // current segment. The keyframes themselves are 16 bits, but the first
+    // segment starts wherever the motor is.
+    int32_t previous, from, to, next;
+    // The position, and its first, second and third differences from one
+    // sample to the next, with 32 fractional bits
+    int64_t position, difference1, difference2, difference3;
+};
+
+template <class Controller>
+class BricktronicsControlledKeyframePlayer
+{
+    public:
+        // The motors are an array of pointers to motors, and axes an array of
+        // BricktronicsKeyframeAxis, both count long. Neither is copied, so
+        // they need to stay around (global variables are easiest).
+        BricktronicsControlledKeyframePlayer(BricktronicsControlledMotor<Controller> **motors, BricktronicsKeyframeAxis *axes, uint8_t count):
+            _motors(motors),
+            _axes(axes),
+            _count(count),
+            _source(NULL),
+            _playing(false),
+            _looping(false),
+            _sampleTimeMS(BRICKTRONICS_KEYFRAME_SAMPLE_TIME_MS),
+            _showTimeMS(0)
+        {
+        }
+
+        // Starts playing the keyframes from the source, from where the motors
+        // are now. The source is not copied, so it needs to stay around (a
+        // global variable is easiest). Returns false if it has no keyframes,
+        // or the first one isn't ready yet (try again later).
+        bool play(BricktronicsKeyframeSource *source)
+        {
+            _playing = false;
+            _source = source;
+            // The first segment goes from where the motors are now to the
+            // first keyframe, starting at rest. It starts on the first sample.
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                _axes[i].to = _motors[i]->getPosition();
+                _axes[i].position = (int64_t) _axes[i].to * 4294967296LL;
+            }
+            _hasPrevious = false;
+            if( !_source->ready() || !_readNext() )
+            {
+                return false;
+            }
+            _stepsLeft = 0;
+            _remainderMS = 0;
+            _showTimeMS = 0;
+            _lastSample = millis();
+            _playing = true;
+            return true;
+        }
+
+        // Stops playing, and holds all the motors where they are.
+        void stop(void)
+        {
+            _playing = false;
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                _motors[i]->hold();
+            }
+        }
+
+        // True until the last keyframe has been reached (never, when looping).
+        bool isPlaying(void)
+        {
+            return _playing;
+        }
+
+        // When the keyframes run out, start over from the first one (if the
+        // source can rewind). The first keyframe's duration is then the time
+        // from the last keyframe.
+        void setLooping(bool looping)
+        {
+            _looping = looping;
+        }
+        bool getLooping(void)
+        {
+            return _looping;
+        }
+
+        // How long (ms) the keyframes have been playing, not counting any
+        // time spent waiting for a source that wasn't ready().
+        uint32_t getTimeMS(void)
+        {
+            return _showTimeMS;
+        }
+
+        // Set how often (ms) the motors are moved along their curves.
+        // Defaults to 10.
+        void setSampleTimeMS(uint16_t sampleTimeMS)
+        {
+            if( sampleTimeMS > 0 )
+            {
+                _sampleTimeMS = sampleTimeMS;
+            }
+        }
+
+        // Call this (instead of each motor's update()) as often as you can.
+        // It updates all the motors, and moves them along every _sampleTimeMS.
+        // If it wasn't called for a while, it catches up, so the keyframes
+        // stay on time.
+        void update(void)
+        {
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                _motors[i]->update();
+            }
+            if( !_playing )
+            {
+                return;
+            }
+            _source->poll();
+
+            unsigned long now = millis();
+            if( now - _lastSample < _sampleTimeMS )
+            {
+                return;
+            }
+            while( _playing && now - _lastSample >= _sampleTimeMS )
+            {
+                _lastSample += _sampleTimeMS;
+                _step();
+            }
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                // Round the position to the nearest tick
+                _motors[i]->goToPosition(( _axes[i].position + 0x80000000LL ) >> 32);
+            }
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        BricktronicsControlledMotor<Controller> **_motors;
+        BricktronicsKeyframeAxis *_axes;
+        uint8_t _count;
+        BricktronicsKeyframeSource *_source;
+        bool _playing;
+        bool _looping;
+        uint16_t _sampleTimeMS;
+        unsigned long _lastSample;
+        uint32_t _showTimeMS;
+
+        // The durations before, of, and after the current segment
+        uint16_t _previousMS, _durationMS, _nextMS;
+        bool _hasPrevious, _hasNext;
+        // Samples left in the current segment, and the time left over from
+        // the last one, which wasn't a whole number of samples
+        uint16_t _stepsLeft;
+        uint16_t _remainderMS;
+
+        // Reads the keyframe after the current segment, if there is one
+        bool _readNext(void)
+        {
+            _hasNext = _source->readDuration(&_nextMS);
+            if( !_hasNext && _looping && _source->rewind() )
+            {
+                _hasNext = _source->readDuration(&_nextMS);
+            }
+            if( _hasNext )
+            {
+                for( uint8_t i = 0; i < _count; i++ )
+                {
+                    _axes[i].next = _source->readPosition();
+                }
+            }
+            return _hasNext;
+        }
+
+        // Moves along to the segment that ends at the next keyframe
+        void _nextSegment(void)
+        {
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                BricktronicsKeyframeAxis &axis = _axes[i];
+                axis.previous = axis.from;
+                axis.from = axis.to;
+                axis.to = axis.next;
+            }
+            _previousMS = _durationMS;
+            _durationMS = _nextMS;
+            _readNext();
+        }
+
+        // Works out the differences for the current segment. The cubic goes
+        // from "from" to "to" as s goes from 0 to 1, with the slope at each
+        // end set by the keyframes on either side (zero at the first and last
+        // keyframes). The samples are h apart in s, and the last one before
+        // this segment started was at s0 (0 or a little less). This uses
+        // floating point, but only once per segment.
+        void _startSegment(void)
+        {
+            uint16_t leftoverMS = _remainderMS;
+            uint32_t time = (uint32_t) _durationMS + leftoverMS;
+            _stepsLeft = time / _sampleTimeMS;
+            _remainderMS = time % _sampleTimeMS;
+            if( _stepsLeft == 0 )
+            {
+                // No samples land in this segment
+                return;
+            }
+            double h = (double) _sampleTimeMS / _durationMS;
+            double s0 = - (double) leftoverMS / _durationMS;
+            // Scales the slopes from ticks per ms to ticks per segment
+            double previousScale = _hasPrevious ? (double) _durationMS / ( (uint32_t) _previousMS + _durationMS ) : 0;
+            double nextScale = _hasNext ? (double) _durationMS / ( (uint32_t) _durationMS + _nextMS ) : 0;
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                BricktronicsKeyframeAxis &axis = _axes[i];
+                double from = axis.from;
+                double to = axis.to;
+                double slopeFrom = ( to - axis.previous ) * previousScale;
+                double slopeTo = ( axis.next - from ) * nextScale;
+                // position(s) = a s^3 + b s^2 + c s + from
+                double a = 2 * ( from - to ) + slopeFrom + slopeTo;
+                double b = 3 * ( to - from ) - 2 * slopeFrom - slopeTo;
+                double c = slopeFrom;
+                // The differences at s0, worked out directly rather than by
+                // subtracting positions, which would lose the small ones.
+                axis.position = (int64_t) axis.from * 4294967296LL + _toFixed(( ( a * s0 + b ) * s0 + c ) * s0);
+                axis.difference1 = _toFixed(a * ( ( 3 * s0 * s0 + 3 * s0 * h + h * h ) * h ) + b * ( ( 2 * s0 + h ) * h ) + c * h);
+                axis.difference2 = _toFixed(a * ( 6 * ( s0 + h ) * h * h ) + b * 2 * h * h);
+                axis.difference3 = _toFixed(a * 6 * h * h * h);
+            }
+        }
+
+        // To 32 fractional bits, rounded. Rounding matters for the third
+        // difference, which is tiny on long segments and gets added up
+        // (steps^3 / 6) times. A segment of 2000 samples (20 seconds) still
+        // ends up within a fifth of a tick.
+        static int64_t _toFixed(double value)
+        {
+            value *= 4294967296.0;
+            return (int64_t) ( value < 0 ? value - 0.5 : value + 0.5 );
+        }
+
+        // Moves every motor one sample along
+        void _step(void)
+        {
+            while( _stepsLeft == 0 )
+            {
+                if( !_hasNext )
+                {
+                    // Land exactly on the last keyframe
+                    for( uint8_t i = 0; i < _count; i++ )
+                    {
+                        _axes[i].position = (int64_t) _axes[i].to * 4294967296LL;
+                    }
+                    _playing = false;
+                    return;
+                }
+                if( !_source->ready() )
+                {
+                    // The keyframe after the next one hasn't come in yet
+                    // (it's needed for the speed at the next keyframe), so
+                    // wait here for it.
+                    return;
+                }
+                _nextSegment();
+                _startSegment();
+                _hasPrevious = true;
+            }
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                BricktronicsKeyframeAxis &axis = _axes[i];
+                axis.position += axis.difference1;
+                axis.difference1 += axis.difference2;
+                axis.difference2 += axis.difference3;
+            }
+            _stepsLeft--;
+            _showTimeMS += _sampleTimeMS;
+        }
+};
+
+// The usual player, for motors with PID position control
+typedef BricktronicsControlledKeyframePlayer<BricktronicsPIDController> BricktronicsKeyframePlayer;
+
+#endif // #ifndef BRICKTRONICSKEYFRAMEPLAYER_H
@@ -41,6 +41,20 @@
 #include "utility/Encoder.h"
 #include "utility/PID_v1.h"
 #include "utility/BricktronicsSettings.h"
+#include "utility/BricktronicsEstimator.h"
+
+// To measure how long update() takes and how steadily the control loop runs,
+// #define BRICKTRONICS_MOTOR_TIMING before including any of the Bricktronics
+// libraries (see the timing* functions below). Without it, none of that is
+// compiled in.
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+#include "utility/BricktronicsTiming.h"
+#endif
+
+// The learned feed-forward map can be saved to the EEPROM on AVR boards
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
 
 // These are the default motor PID values for P, I, and D.
 // Tested on an unloaded NXT 2.0 motor, you may want to adjust these
@@ -49,29 +63,273 @@
 #define BRICKTRONICS_MOTOR_PID_KI                           14.432
 #define BRICKTRONICS_MOTOR_PID_KD                           0.1207317073
 
+// The alternative position controllers start out with the PID values above
+#include "utility/BricktronicsControllers.h"
+
 // We can have different motor modes
 #define BRICKTRONICS_MOTOR_MODE_COAST                       0
 #define BRICKTRONICS_MOTOR_MODE_BRAKE                       1
 #define BRICKTRONICS_MOTOR_MODE_FIXED_DRIVE                 2
 #define BRICKTRONICS_MOTOR_MODE_PID_POSITION                3
 #define BRICKTRONICS_MOTOR_MODE_PID_SPEED                   4
+#define BRICKTRONICS_MOTOR_MODE_PID_CASCADE                 5
+#define BRICKTRONICS_MOTOR_MODE_AUTOTUNE                    6
+#define BRICKTRONICS_MOTOR_MODE_MIN_TIME                    7
 
 // Sample time - Call update() as often as you can, but it will only update
 // as often as this value. Can be updated by the user at runtime if desired.
 #define BRICKTRONICS_MOTOR_PID_SAMPLE_TIME_MS               50
 
+// These are the default PID values for the inner speed loop, which takes a
+// speed in encoder ticks per second and produces a motor drive strength.
+// It is used by setSpeed() and by the cascaded position control mode, and it
+// runs faster than the position loop, so it has its own sample time.
+#define BRICKTRONICS_MOTOR_SPEED_PID_KP                     0.1
+#define BRICKTRONICS_MOTOR_SPEED_PID_KI                     3.0
+#define BRICKTRONICS_MOTOR_SPEED_PID_KD                     0
+#define BRICKTRONICS_MOTOR_SPEED_PID_SAMPLE_TIME_MS         10
+
+// These are the default values for the outer position loop of the cascaded
+// controller, which turns a position error (ticks) into a speed command
+// (ticks per second) for the inner speed loop. The outer loop is limited to
+// BRICKTRONICS_MOTOR_CASCADE_MAX_SPEED, a bit below the no-load speed of an
+// NXT motor at 9V, so the speed loop always has some drive strength in reserve.
+#define BRICKTRONICS_MOTOR_CASCADE_KP                       6.0
+#define BRICKTRONICS_MOTOR_CASCADE_KI                       0
+#define BRICKTRONICS_MOTOR_CASCADE_MAX_SPEED                1200
+
 #define BRICKTRONICS_MOTOR_ANGLE_MULTIPLIER_DEFAULT         1
 // Epsilon is used to evaluate if we are at a desired position (abs(getPosition() - desiredPosition) < epsilon)
 #define BRICKTRONICS_MOTOR_EPSILON_DEFAULT                  5
 // This constant is used to determine if the PID algorithm has settled down enough to stop calling update() and just call brake()
 // Used to try and avoid overshoot by stopping PID updates too early.
 #define BRICKTRONICS_MOTOR_PID_OUTPUT_SETTLED_THRESHOLD     30
+// With an estimator attached, the motor also has to be slower than this
+// (in ticks per second) to count as settled.
+#define BRICKTRONICS_MOTOR_SETTLED_SPEED_THRESHOLD          30
+
+// Stall detection (which needs an estimator attached): the motor is stalled
+// when it is driven at least this hard, but moves slower than this speed
+// (ticks per second), for at least this long.
+#define BRICKTRONICS_MOTOR_STALL_DRIVE                      100
+#define BRICKTRONICS_MOTOR_STALL_SPEED                      20
+#define BRICKTRONICS_MOTOR_STALL_TIME_MS                    200
+
+// The disturbance observer (which also needs an estimator attached) smooths
+// its load estimate with a low-pass filter with this time constant.
+#define BRICKTRONICS_MOTOR_DOB_FILTER_TIME_MS               20
+
+// The backlash calibration gives up if the motor doesn't stall in each
+// direction within this time.
+#define BRICKTRONICS_MOTOR_BACKLASH_TIMEOUT_MS              3000
+
+// With a load encoder, the position loop sees the motor position plus the
+// difference to the load position, low-pass filtered with this time constant.
+#define BRICKTRONICS_MOTOR_LOAD_FILTER_TIME_MS              50
+
+// The relay autotuner drives the motor back and forth around its starting
+// position and measures the resulting oscillation. The first few cycles are
+// ignored while the oscillation builds up, then the amplitude and period are
+// averaged over the next few cycles. The hysteresis (in ticks) keeps encoder
+// jitter from flipping the relay, and the autotune is abandoned if the relay
+// doesn't switch for the timeout period (the motor might be stuck).
+#define BRICKTRONICS_MOTOR_AUTOTUNE_SETTLE_CYCLES           2
+#define BRICKTRONICS_MOTOR_AUTOTUNE_MEASURE_CYCLES          4
+#define BRICKTRONICS_MOTOR_AUTOTUNE_HYSTERESIS              2
+#define BRICKTRONICS_MOTOR_AUTOTUNE_TIMEOUT_MS              3000
+
+// Autotune status values, see autotuneGetStatus()
+#define BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_IDLE             0
+#define BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_RUNNING          1
+#define BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_DONE             2
+#define BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_FAILED           3
+
+// Tuning rules that turn the ultimate gain and period into PID tunings.
+// Ziegler-Nichols is the most aggressive, the others trade speed for less
+// overshoot and more robustness, which is usually what you want with a load.
+#define BRICKTRONICS_MOTOR_AUTOTUNE_RULE_ZIEGLER_NICHOLS    0
+#define BRICKTRONICS_MOTOR_AUTOTUNE_RULE_ZIEGLER_NICHOLS_PI 1
+#define BRICKTRONICS_MOTOR_AUTOTUNE_RULE_TYREUS_LUYBEN      2
+#define BRICKTRONICS_MOTOR_AUTOTUNE_RULE_SOME_OVERSHOOT     3
+#define BRICKTRONICS_MOTOR_AUTOTUNE_RULE_NO_OVERSHOOT       4
+
+// The step response identification records this many encoder samples in a
+// buffer on the stack (two bytes each), so it only uses that RAM while it runs.
+// The motor brakes for the rest time before the step, so it starts from a stop.
+#define BRICKTRONICS_MOTOR_SYSID_SAMPLES                    100
+#define BRICKTRONICS_MOTOR_SYSID_REST_MS                    500
+// The samples are counted with a uint8_t, and the fit needs a quarter of them
+#if BRICKTRONICS_MOTOR_SYSID_SAMPLES < 4 || BRICKTRONICS_MOTOR_SYSID_SAMPLES > 255
+#error "BRICKTRONICS_MOTOR_SYSID_SAMPLES must be from 4 to 255"
+#endif
+
+// Until a step response model has been fitted, the minimum-time moves and
+// the disturbance observer use this model of an unloaded NXT motor: speed
+// gain (ticks per second per unit of drive), time constant and dead time.
+#define BRICKTRONICS_MOTOR_MODEL_GAIN                       8.0
+#define BRICKTRONICS_MOTOR_MODEL_TIME_CONSTANT_MS           60
+#define BRICKTRONICS_MOTOR_MODEL_DELAY_MS                   2
+
+// A gain schedule can have up to this many breakpoints on each axis
+#define BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS         3
+
+// The minimum-time moves brake along a switching curve (braking distance
+// versus speed) stored in a table with this many points, two bytes each.
+#define BRICKTRONICS_MOTOR_MIN_TIME_CURVE_POINTS            16
+// Within this many ticks of the destination, the minimum-time move hands
+// off to the position PID for the final settling.
+#define BRICKTRONICS_MOTOR_MIN_TIME_HANDOFF                 4
+
+// Input shaper types, see setInputShaper()
+#define BRICKTRONICS_MOTOR_SHAPER_NONE                      0
+#define BRICKTRONICS_MOTOR_SHAPER_ZV                        1
+#define BRICKTRONICS_MOTOR_SHAPER_ZVD                       2
+// The input shaper samples the position it's asked for this many times per
+// half period of the vibration, and keeps a full period of samples.
+#define BRICKTRONICS_MOTOR_SHAPER_TAP_SPACING               8
+
+// The learned feed-forward map splits one period of motor positions (by
+// default 720 ticks, one turn of the motor) into this many bins.
+#define BRICKTRONICS_MOTOR_FF_MAP_BINS                      64
+#define BRICKTRONICS_MOTOR_FF_MAP_PERIOD                    720
+// While learning, this many 256ths of the integral term are moved into the
+// map on every controller sample.
+#define BRICKTRONICS_MOTOR_FF_MAP_LEARN_RATE                16
+// The EEPROM space used by ffMapSave(): the period, the bins and a checksum.
+#define BRICKTRONICS_MOTOR_FF_MAP_EEPROM_SIZE               ( 2 + 2 * BRICKTRONICS_MOTOR_FF_MAP_BINS + 1 )
+
+// Iterative learning control keeps one correction per sample of a run, two
+// bytes each. The defaults cover a run of 64 * 20 ms = 1.28 seconds.
+#define BRICKTRONICS_MOTOR_ILC_SAMPLES                      64
+#define BRICKTRONICS_MOTOR_ILC_SAMPLE_TIME_MS               20
+// Drive strength added to a correction per tick of error, on each run
+#define BRICKTRONICS_MOTOR_ILC_GAIN                         0.5
+// How many samples later the error shows the effect of a correction
+#define BRICKTRONICS_MOTOR_ILC_LEAD                         3
+
+// Trace trigger conditions, see traceSetTrigger()
+#define BRICKTRONICS_MOTOR_TRACE_TRIGGER_STALL              0x01
+#define BRICKTRONICS_MOTOR_TRACE_TRIGGER_ERROR              0x02
+#define BRICKTRONICS_MOTOR_TRACE_TRIGGER_SATURATED          0x04
+
+// Trace sample flags
+#define BRICKTRONICS_MOTOR_TRACE_STALLED                    0x01
+#define BRICKTRONICS_MOTOR_TRACE_SATURATED                  0x02
+// The sample that set off the trigger
+#define BRICKTRONICS_MOTOR_TRACE_TRIGGER                    0x80
+
+// With BRICKTRONICS_MOTOR_TIMING, a control loop sample more than this late
+// counts as a missed deadline. The PID only looks at millis(), so it can be up
+// to a millisecond late on its own.
+#define BRICKTRONICS_MOTOR_TIMING_LATE_US                   1000
+
+// A gain schedule for the position PID, see setGainSchedule(). The tunings
+// are given at each combination of |position error| (in ticks) and |speed|
+// (in ticks per second) breakpoints, and are interpolated in between.
+// The breakpoints must be in strictly increasing order, and outside of the
+// first and last breakpoints the tunings at the nearest breakpoint are used.
+// The *Scale members are filled in by setGainSchedule(), leave them alone.
+typedef struct BricktronicsMotorGainSchedule
+{
+   uint8_t errorPoints;
+   uint8_t speedPoints;
+   uint16_t errorBreakpoints[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS];
+   uint16_t speedBreakpoints[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS];
+   // Indexed as [error breakpoint][speed breakpoint]
+   double Kp[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS][BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS];
+   double Ki[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS][BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS];
+   double Kd[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS][BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS];
+   uint16_t errorScale[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS - 1];
+   uint16_t speedScale[BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS - 1];
+} BricktronicsMotorGainSchedule;
+
+// A learned position-dependent feed-forward map, see setFeedForwardMap().
+// Each bin holds the extra drive strength (in 16ths) needed at the start of
+// its slice of the period, and the map interpolates between them.
+typedef struct BricktronicsMotorFeedForwardMap
+{
+   int16_t drive[BRICKTRONICS_MOTOR_FF_MAP_BINS];
+} BricktronicsMotorFeedForwardMap;
+
+// The corrections learned by iterative learning control, see setIterativeLearning().
+// Each one is the extra drive strength (in 16ths) for one sample of a run.
+typedef struct BricktronicsMotorILC
+{
+   int16_t correction[BRICKTRONICS_MOTOR_ILC_SAMPLES];
+} BricktronicsMotorILC;
+
+// One control loop sample in a trace, see traceBegin(). The setpoint and
+// input are positions (in ticks), or speeds (in ticks per second) in the
+// speed mode, and the output is the drive strength.
+typedef struct BricktronicsMotorTraceSample
+{
+   uint32_t timeUS;
+   int32_t setpoint;
+   int32_t input;
+   int16_t output;
+   uint8_t mode;
+   uint8_t flags;
+} BricktronicsMotorTraceSample;
+
+// The default position controller, the PID library with the default PID
+// values above. It has the same interface as the alternative controllers in
+// utility/BricktronicsControllers.h, so any of them can be used in its place.
+class BricktronicsPIDController : public PID
+{
+    public:
+        static const bool PIDTunings = true;
+
+        BricktronicsPIDController(double *input, double *output, double *setpoint):
+            PID(input, output, setpoint, BRICKTRONICS_MOTOR_PID_KP, BRICKTRONICS_MOTOR_PID_KI, BRICKTRONICS_MOTOR_PID_KD, DIRECT)
+        {
+            // The PID library starts out with a 100 ms sample time
+            _setScheduleScale(100);
+        }
+
+        void SetSampleTime(int NewSampleTime)
+        {
+            PID::SetSampleTime(NewSampleTime);
+            if( NewSampleTime > 0 )
+            {
+                _setScheduleScale(NewSampleTime);
+            }
+        }
+
+        // The same as SetTunings(), but with the sample time scaling that
+        // the PID library would do (with two divisions) worked out ahead of
+        // time, for gain schedules.
+        void ScheduleTunings(double Kp, double Ki, double Kd)
+        {
+            SetScaledTunings(Kp, Ki * _scheduleKiScale, Kd * _scheduleKdScale);
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        double _scheduleKiScale, _scheduleKdScale;
+
+        void _setScheduleScale(int sampleTimeMS)
+        {
+            _scheduleKiScale = sampleTimeMS / 1000.0;
+            _scheduleKdScale = 1000.0 / sampleTimeMS;
+        }
+};
 
-class BricktronicsMotor
+// The motor class is a template on the position controller, which is picked at
+// compile time so there's no run-time cost to switching between controllers,
+// and the controllers you don't use don't take up any flash or RAM. Usually you
+// will just use BricktronicsMotor (at the bottom of this file), which uses the
+// PID controller. To use a different one, declare your motor like this:
+// BricktronicsControlledMotor<BricktronicsSlidingModeController> m(3, 4, 10, 2, 5);
+// The pid* functions set the controller's tunings, whatever they mean for
+// that controller. The speed loop is always a PID loop.
+template <class Controller>
+class BricktronicsControlledMotor
 {
     public:
         // Constructor - Simple constructor accepts the five motor pins
-        BricktronicsMotor(uint8_t enPin,
+        BricktronicsControlledMotor(uint8_t enPin,
                           uint8_t dirPin,
                           uint8_t pwmPin,
                           uint8_t encoderPin1,
@@ -81,10 +339,70 @@ class BricktronicsMotor
             _pwmPin(pwmPin),
             _rawSpeed(0),
             _reversed(false),
-            _pid(&_pidInput, &_pidOutput, &_pidSetpoint, BRICKTRONICS_MOTOR_PID_KP, BRICKTRONICS_MOTOR_PID_KI, BRICKTRONICS_MOTOR_PID_KD, DIRECT),
-            _pidKp(BRICKTRONICS_MOTOR_PID_KP),
-            _pidKi(BRICKTRONICS_MOTOR_PID_KI),
-            _pidKd(BRICKTRONICS_MOTOR_PID_KD),
+            _pid(&_pidInput, &_pidOutput, &_pidSetpoint),
+            _pidKp(_pid.GetKp()),
+            _pidKi(_pid.GetKi()),
+            _pidKd(_pid.GetKd()),
+            _pidSampleTimeMS(BRICKTRONICS_MOTOR_PID_SAMPLE_TIME_MS),
+            _speedPid(&_speedPidInput, &_speedPidOutput, &_speedPidSetpoint, BRICKTRONICS_MOTOR_SPEED_PID_KP, BRICKTRONICS_MOTOR_SPEED_PID_KI, BRICKTRONICS_MOTOR_SPEED_PID_KD, DIRECT),
+            _speedPidKp(BRICKTRONICS_MOTOR_SPEED_PID_KP),
+            _speedPidKi(BRICKTRONICS_MOTOR_SPEED_PID_KI),
+            _speedPidKd(BRICKTRONICS_MOTOR_SPEED_PID_KD),
+            _speedSampleTimeMS(BRICKTRONICS_MOTOR_SPEED_PID_SAMPLE_TIME_MS),
+            _cascade(false),
+            _cascadeKp(BRICKTRONICS_MOTOR_CASCADE_KP),
+            _cascadeKi(BRICKTRONICS_MOTOR_CASCADE_KI),
+            _cascadeMaxSpeed(BRICKTRONICS_MOTOR_CASCADE_MAX_SPEED),
+            _autotuneStatus(BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_IDLE),
+            _feedForward(0),
+            _modelGain(0),
+            _modelFeedForward(false),
+            _gainSchedule(NULL),
+            _minTimeHandoff(BRICKTRONICS_MOTOR_MIN_TIME_HANDOFF),
+            _estimator(NULL),
+            _drive(0),
+            _controlSamples(0),
+            _stallDrive(BRICKTRONICS_MOTOR_STALL_DRIVE),
+            _stallSpeed(BRICKTRONICS_MOTOR_STALL_SPEED),
+            _stallTimeMS(BRICKTRONICS_MOTOR_STALL_TIME_MS),
+            _stallSince(0),
+            _stalled(false),
+            _trace(NULL),
+            _traceSize(0),
+            _traceHead(0),
+            _traceCount(0),
+            _traceConditions(0),
+            _traceErrorThreshold(0),
+            _traceAfter(0),
+            _traceRemaining(0),
+            _traceTriggered(false),
+            _traceTriggerUS(0),
+            _dobEnabled(false),
+            _dobFilterTimeMS(BRICKTRONICS_MOTOR_DOB_FILTER_TIME_MS),
+            _dobDisturbance(0),
+            _backlash(0),
+            _backlashSide(0),
+            _backlashTarget(0),
+            _backlashOutput(0),
+            _ffMap(NULL),
+            _ffMapPeriod(BRICKTRONICS_MOTOR_FF_MAP_PERIOD),
+            _ffMapLearning(false),
+            _ffMapLastPosition(0),
+            _ffMapLastTime(0),
+            _ilc(NULL),
+            _ilcSampleTimeMS(BRICKTRONICS_MOTOR_ILC_SAMPLE_TIME_MS),
+            _ilcGain(BRICKTRONICS_MOTOR_ILC_GAIN),
+            _ilcLead(BRICKTRONICS_MOTOR_ILC_LEAD),
+            _ilcRunning(false),
+            _ilcIndex(0),
+            _ilcRunStart(0),
+            _ilcErrorSum(0),
+            _ilcRunError(0),
+            _shaperType(BRICKTRONICS_MOTOR_SHAPER_NONE),
+            _shaperActive(false),
+            _shaperHead(0),
+            _loadEncoder(NULL),
+            _loadAlpha(65535UL / ( BRICKTRONICS_MOTOR_LOAD_FILTER_TIME_MS + 1 )),
             _mode(BRICKTRONICS_MOTOR_MODE_COAST),
             _encoder(encoderPin1, encoderPin2),
             _angleMultiplier(BRICKTRONICS_MOTOR_ANGLE_MULTIPLIER_DEFAULT),
@@ -95,20 +413,87 @@ class BricktronicsMotor
         {
             _pid.SetSampleTime(BRICKTRONICS_MOTOR_PID_SAMPLE_TIME_MS);
             _pid.SetOutputLimits(-255, +255);
+            _speedPid.SetSampleTime(BRICKTRONICS_MOTOR_SPEED_PID_SAMPLE_TIME_MS);
+            _speedPid.SetOutputLimits(-255, +255);
+            _minTimeBuildCurve(BRICKTRONICS_MOTOR_MODEL_GAIN, BRICKTRONICS_MOTOR_MODEL_TIME_CONSTANT_MS, BRICKTRONICS_MOTOR_MODEL_DELAY_MS);
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+            _timingLateUS = BRICKTRONICS_MOTOR_TIMING_LATE_US;
+            timingReset();
+#endif
         }
 
         // Constructor - Advanced constructor accepts a BricktronicsMotorSettings struct
         // to also override the low-level Arduino functions.
-        BricktronicsMotor(const BricktronicsMotorSettings &settings):
+        BricktronicsControlledMotor(const BricktronicsMotorSettings &settings):
             _enPin(settings.enPin),
             _dirPin(settings.dirPin),
             _pwmPin(settings.pwmPin),
             _rawSpeed(0),
             _reversed(settings.reversedMotorDrive), // See note below about why this is set to true for Bricktronics Shield
-            _pid(&_pidInput, &_pidOutput, &_pidSetpoint, BRICKTRONICS_MOTOR_PID_KP, BRICKTRONICS_MOTOR_PID_KI, BRICKTRONICS_MOTOR_PID_KD, DIRECT),
-            _pidKp(BRICKTRONICS_MOTOR_PID_KP),
-            _pidKi(BRICKTRONICS_MOTOR_PID_KI),
-            _pidKd(BRICKTRONICS_MOTOR_PID_KD),
+            _pid(&_pidInput, &_pidOutput, &_pidSetpoint),
+            _pidKp(_pid.GetKp()),
+            _pidKi(_pid.GetKi()),
+            _pidKd(_pid.GetKd()),
+            _pidSampleTimeMS(BRICKTRONICS_MOTOR_PID_SAMPLE_TIME_MS),
+            _speedPid(&_speedPidInput, &_speedPidOutput, &_speedPidSetpoint, BRICKTRONICS_MOTOR_SPEED_PID_KP, BRICKTRONICS_MOTOR_SPEED_PID_KI, BRICKTRONICS_MOTOR_SPEED_PID_KD, DIRECT),
+            _speedPidKp(BRICKTRONICS_MOTOR_SPEED_PID_KP),
+            _speedPidKi(BRICKTRONICS_MOTOR_SPEED_PID_KI),
+            _speedPidKd(BRICKTRONICS_MOTOR_SPEED_PID_KD),
+            _speedSampleTimeMS(BRICKTRONICS_MOTOR_SPEED_PID_SAMPLE_TIME_MS),
+            _cascade(false),
+            _cascadeKp(BRICKTRONICS_MOTOR_CASCADE_KP),
+            _cascadeKi(BRICKTRONICS_MOTOR_CASCADE_KI),
+            _cascadeMaxSpeed(BRICKTRONICS_MOTOR_CASCADE_MAX_SPEED),
+            _autotuneStatus(BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_IDLE),
+            _feedForward(0),
+            _modelGain(0),
+            _modelFeedForward(false),
+            _gainSchedule(NULL),
+            _minTimeHandoff(BRICKTRONICS_MOTOR_MIN_TIME_HANDOFF),
+            _estimator(NULL),
+            _drive(0),
+            _controlSamples(0),
+            _stallDrive(BRICKTRONICS_MOTOR_STALL_DRIVE),
+            _stallSpeed(BRICKTRONICS_MOTOR_STALL_SPEED),
+            _stallTimeMS(BRICKTRONICS_MOTOR_STALL_TIME_MS),
+            _stallSince(0),
+            _stalled(false),
+            _trace(NULL),
+            _traceSize(0),
+            _traceHead(0),
+            _traceCount(0),
+            _traceConditions(0),
+            _traceErrorThreshold(0),
+            _traceAfter(0),
+            _traceRemaining(0),
+            _traceTriggered(false),
+            _traceTriggerUS(0),
+            _dobEnabled(false),
+            _dobFilterTimeMS(BRICKTRONICS_MOTOR_DOB_FILTER_TIME_MS),
+            _dobDisturbance(0),
+            _backlash(0),
+            _backlashSide(0),
+            _backlashTarget(0),
+            _backlashOutput(0),
+            _ffMap(NULL),
+            _ffMapPeriod(BRICKTRONICS_MOTOR_FF_MAP_PERIOD),
+            _ffMapLearning(false),
+            _ffMapLastPosition(0),
+            _ffMapLastTime(0),
+            _ilc(NULL),
+            _ilcSampleTimeMS(BRICKTRONICS_MOTOR_ILC_SAMPLE_TIME_MS),
+            _ilcGain(BRICKTRONICS_MOTOR_ILC_GAIN),
+            _ilcLead(BRICKTRONICS_MOTOR_ILC_LEAD),
+            _ilcRunning(false),
+            _ilcIndex(0),
+            _ilcRunStart(0),
+            _ilcErrorSum(0),
+            _ilcRunError(0),
+            _shaperType(BRICKTRONICS_MOTOR_SHAPER_NONE),
+            _shaperActive(false),
+            _shaperHead(0),
+            _loadEncoder(NULL),
+            _loadAlpha(65535UL / ( BRICKTRONICS_MOTOR_LOAD_FILTER_TIME_MS + 1 )),
             _mode(BRICKTRONICS_MOTOR_MODE_COAST),
             _encoder(settings.encoderPin1, settings.encoderPin2),
             _angleMultiplier(BRICKTRONICS_MOTOR_ANGLE_MULTIPLIER_DEFAULT),
@@ -119,15 +504,25 @@ class BricktronicsMotor
         {
             _pid.SetSampleTime(BRICKTRONICS_MOTOR_PID_SAMPLE_TIME_MS);
             _pid.SetOutputLimits(-255, +255);
+            _speedPid.SetSampleTime(BRICKTRONICS_MOTOR_SPEED_PID_SAMPLE_TIME_MS);
+            _speedPid.SetOutputLimits(-255, +255);
+            _minTimeBuildCurve(BRICKTRONICS_MOTOR_MODEL_GAIN, BRICKTRONICS_MOTOR_MODEL_TIME_CONSTANT_MS, BRICKTRONICS_MOTOR_MODEL_DELAY_MS);
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+            _timingLateUS = BRICKTRONICS_MOTOR_TIMING_LATE_US;
+            timingReset();
+#endif
         }
 
         // Set the dir/pwm/en pins as outputs and sets the motor to coast.
         void begin(void)
         {
             _pid.SetMode(AUTOMATIC);
+            _speedPid.SetMode(AUTOMATIC);
             _pinMode(_dirPin, OUTPUT);
             _pinMode(_pwmPin, OUTPUT);
             _pinMode(_enPin, OUTPUT);
+            _backlashOutput = _encoder.read();
+            _backlashTarget = _backlashOutput;
             coast();
         }
 
@@ -139,6 +534,7 @@ class BricktronicsMotor
         void coast(void)
         {
             _mode = BRICKTRONICS_MOTOR_MODE_COAST;
+            _drive = 0;
             _digitalWrite(_dirPin, LOW);
             _digitalWrite(_pwmPin, LOW);
             _digitalWrite(_enPin, LOW);
@@ -152,6 +548,7 @@ class BricktronicsMotor
         void brake(void)
         {
             _mode = BRICKTRONICS_MOTOR_MODE_BRAKE;
+            _drive = 0;
             _digitalWrite(_dirPin, LOW);
             _digitalWrite(_pwmPin, LOW);
             _digitalWrite(_enPin, HIGH);
@@ -164,7 +561,9 @@ class BricktronicsMotor
         // Just like with goToPosition(), you need to periodically call update().
         void hold(void)
         {
-            goToPosition(getPosition());
+            _shaperActive = false;
+            _backlashTarget = _backlashOutput;
+            _goToMotorPosition(getPosition());
         }
 
         // Read the encoder's current position.
@@ -178,6 +577,16 @@ class BricktronicsMotor
         void setPosition(int32_t pos)
         {
             _encoder.write(pos);
+            _backlashOutput = pos - _backlashSide * ( _backlash / 2 );
+            _backlashTarget = _backlashOutput;
+            _ffMapLastPosition = pos;
+            _shaperActive = false;
+            _loadPosition = pos;
+            _loadOffset = 0;
+            if( _estimator )
+            {
+                _estimator->reset(pos, micros());
+            }
         }
 
         // Motors have some slop in their encoder output readings, so this function
@@ -186,10 +595,30 @@ class BricktronicsMotor
         // This function also checks to ensure that the PID algorithm has settled down enough
         // (that is, _pidOutput < BRICKTRONICS_MOTOR_PID_OUTPUT_SETTLED_THRESHOLD) that we
         // can just brake() without having to worry about coasting through the setpoint.
+        // In the cascaded mode, _pidOutput is a speed command, so we check the
+        // drive strength coming out of the inner speed loop instead. A
+        // minimum-time move is never settled until it has handed off to the PID,
+        // and a shaped move until the input shaper has caught up.
+        // With an estimator attached, the motor also has to have (nearly) stopped.
+        // With a load encoder, the load position is checked instead.
         bool settledAtPosition(int32_t position)
         {
-            return(    (abs(getPosition() - position) < _epsilon)
-                    && (abs(_pidOutput) < BRICKTRONICS_MOTOR_PID_OUTPUT_SETTLED_THRESHOLD) );
+            if( _mode == BRICKTRONICS_MOTOR_MODE_MIN_TIME || _shaperActive )
+            {
+                return false;
+            }
+            if( _estimator && abs(_estimator->getSpeed()) >= BRICKTRONICS_MOTOR_SETTLED_SPEED_THRESHOLD )
+            {
+                return false;
+            }
+            double output = ( _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE ) ? _speedPidOutput : _pidOutput;
+            int32_t current = _backlash ? _backlashOutput : getPosition();
+            if( _loadEncoder )
+            {
+                current = _loadPosition;
+            }
+            return(    (abs(current - position) < _epsilon)
+                    && (abs(output) < BRICKTRONICS_MOTOR_PID_OUTPUT_SETTLED_THRESHOLD) );
         }
 
         void setEpsilon(uint8_t epsilon)
@@ -210,12 +639,48 @@ class BricktronicsMotor
         // updated below.
         void update(void)
         {
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+            uint32_t start = BRICKTRONICS_TIMING_TICKS();
+#endif
+            uint16_t samples = _controlSamples;
+            if( _loadEncoder )
+            {
+                _updateLoadEncoder();
+            }
+            if( _estimator )
+            {
+                _updateEstimator();
+            }
+            if( _backlash )
+            {
+                _updateBacklash();
+            }
+            if( _ilcRunning )
+            {
+                _updateILC();
+            }
+            if( _shaperActive )
+            {
+                _updateShaper();
+            }
+
             switch( _mode )
             {
                 case BRICKTRONICS_MOTOR_MODE_PID_POSITION:
-                    _pidInput = _encoder.read();
-                    _pid.Compute();
-                    _rawSetSpeed(_pidOutput);
+                    _pidInput = _feedbackPosition();
+                    if( _pid.Compute() )
+                    {
+                        _controlSamples++;
+                        if( _gainSchedule )
+                        {
+                            _updateGainSchedule();
+                        }
+                        if( _ffMapLearning )
+                        {
+                            _ffMapLearn(_pid.GetITerm());
+                        }
+                    }
+                    _applyDrive(_pidOutput);
                     /*
                     Serial.print("_pidOutput: ");
                     Serial.print(_pidOutput);
@@ -225,13 +690,45 @@ class BricktronicsMotor
                     break;
 
                 case BRICKTRONICS_MOTOR_MODE_PID_SPEED:
-                    // TODO create implementation of speed control
+                    _updateSpeedLoop();
+                    break;
+
+                case BRICKTRONICS_MOTOR_MODE_PID_CASCADE:
+                    // The outer position loop runs at the (slower) _pid sample
+                    // time and hands a new speed command to the inner loop,
+                    // which runs at its own (faster) sample time.
+                    _pidInput = _feedbackPosition();
+                    if( _pid.Compute() )
+                    {
+                        _speedPidSetpoint = _pidOutput;
+                        if( _gainSchedule )
+                        {
+                            _updateGainSchedule();
+                        }
+                    }
+                    _updateSpeedLoop();
+                    break;
+
+                case BRICKTRONICS_MOTOR_MODE_AUTOTUNE:
+                    _updateAutotune();
+                    break;
+
+                case BRICKTRONICS_MOTOR_MODE_MIN_TIME:
+                    _updateMinTime();
                     break;
 
                 default:
                     // None of the other motor modes need periodic updating.
                     break;
             }
+
+            if( _trace && _controlSamples != samples )
+            {
+                _traceRecord();
+            }
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+            _timingRecord(start, samples);
+#endif
         }
 
         // This function periodically calls update() until delayMS
@@ -252,10 +749,17 @@ class BricktronicsMotor
         // Update the maximum frequency at which the PID algorithm will actually update.
         void pidSetUpdateFrequencyMS(int timeMS)
         {
+            _pidSampleTimeMS = timeMS;
             _pid.SetSampleTime(timeMS);
+            if( _gainSchedule )
+            {
+                setGainSchedule(_gainSchedule);
+            }
         }
 
-        // Print out the PID values to the serial port
+        // Print out the PID values to the serial port. This waits for the
+        // serial port once its transmit buffer fills up, see
+        // BricktronicsMotorTelemetry.h for a stream that doesn't.
         void pidPrintValues(void)
         {
             Serial.print("SET:");
@@ -288,9 +792,18 @@ class BricktronicsMotor
             pidUpdateTunings();
         }
 
+        // When cascaded control is enabled, _pid is the outer position loop
+        // and uses the cascade tunings instead, see cascadeSetTunings() below.
         void pidUpdateTunings(void)
         {
-            _pid.SetTunings(_pidKp, _pidKi, _pidKd);
+            if( _cascade )
+            {
+                _pid.SetTunings(_cascadeKp, _cascadeKi, 0);
+            }
+            else
+            {
+                _pid.SetTunings(_pidKp, _pidKi, _pidKd);
+            }
         }
 
         void pidSetKp(double Kp)
@@ -310,179 +823,2243 @@ class BricktronicsMotor
         }
 
 
-        // Raw, uncontrolled speed settings
-        // There is no monitoring or control of the speed here,
-        // just set a fixed drive strength between -255 and +255 (0 = brake).
-        void setFixedDrive(int16_t s)
+        // Gain scheduling functions
+        // A single set of PID tunings can't always handle both fast moves and a
+        // precise final approach. With a gain schedule, the position PID tunings
+        // are interpolated from a small table based on the size of the position
+        // error and the speed, every time the PID updates. The table is not
+        // copied, so it needs to stay around (a global variable is easiest), and
+        // this function fills in the precomputed scale factors in the table.
+        // Call it again if you change the breakpoints. In the cascaded mode,
+        // the schedule is used for the outer position loop. Pass NULL to stop
+        // using the schedule and go back to the regular PID tunings. Returns
+        // false, and keeps the tunings as they were, if either axis doesn't
+        // have 1 to BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS breakpoints
+        // in strictly increasing order.
+        bool setGainSchedule(BricktronicsMotorGainSchedule *schedule)
         {
-            _mode = BRICKTRONICS_MOTOR_MODE_FIXED_DRIVE;
-            _rawSpeed = s;
-            _rawSetSpeed(_rawSpeed);
+            if( !schedule )
+            {
+                _gainSchedule = NULL;
+                pidUpdateTunings();
+                return true;
+            }
+            if(    !_gainScheduleAxisOK(schedule->errorBreakpoints, schedule->errorPoints)
+                || !_gainScheduleAxisOK(schedule->speedBreakpoints, schedule->speedPoints) )
+            {
+                return false;
+            }
+            _gainSchedule = schedule;
+
+            // The interpolation weights are 8-bit fractions, computed with a
+            // multiply by these 16-bit reciprocals of the breakpoint spacing.
+            for( uint8_t i = 0; i + 1 < schedule->errorPoints; i++ )
+            {
+                schedule->errorScale[i] = 65535UL / ( schedule->errorBreakpoints[i + 1] - schedule->errorBreakpoints[i] );
+            }
+            for( uint8_t i = 0; i + 1 < schedule->speedPoints; i++ )
+            {
+                schedule->speedScale[i] = 65535UL / ( schedule->speedBreakpoints[i + 1] - schedule->speedBreakpoints[i] );
+            }
+
+            _gainScheduleLastInput = _encoder.read();
+            return true;
         }
 
-        // Retrieves the previously-set fixed drive speed
-        int16_t getFixedDrive(void)
+
+        // Feed-forward functions
+        // The feed-forward drive strength is added to the output of the PID
+        // loops in the position, speed and cascaded modes. This is useful when
+        // the load needs a constant drive strength to stay put (like an arm
+        // holding something up against gravity), so the PID doesn't have to
+        // wind up its integral term to get there.
+        void setFeedForward(int16_t drive)
         {
-            return _rawSpeed;
+            _feedForward = drive;
+        }
+        int16_t getFeedForward(void)
+        {
+            return _feedForward;
         }
 
 
-        // Position control functions
-        void goToPosition(int32_t position)
+        // Learned feed-forward map functions
+        // Friction and cogging that change with the position of the motor make
+        // the PID integral term chase them around on every repetitive motion.
+        // A feed-forward map learns, for each slice of a period of motor
+        // positions (one turn of the motor by default), the extra drive strength
+        // that is needed there. While learning, part of the integral term is
+        // moved into the map on every controller sample in the position, speed
+        // and cascaded modes, and the map is added to the PID outputs in those
+        // modes. There is only one map for both directions, so it learns the
+        // position-dependent loads of the motion it sees, and works best when
+        // the motion repeats the same way each time.
+        // The map is not copied, so it needs to stay around (a global variable
+        // is easiest). Pass NULL to stop using it.
+        void setFeedForwardMap(BricktronicsMotorFeedForwardMap *map)
         {
-            // Swith our internal PID into position mode
-            _mode = BRICKTRONICS_MOTOR_MODE_PID_POSITION;
-            _pidSetpoint = position;
+            _ffMap = map;
+        }
+        BricktronicsMotorFeedForwardMap *getFeedForwardMap(void)
+        {
+            return _ffMap;
         }
 
-        // Go to the specified position using PID, but wait for the specified number of milliseconds
-        void goToPositionWaitForDelay(int32_t position, uint32_t delayMS)
+        // Turns learning on or off. Once the map has settled, turning learning
+        // off keeps it from picking up one-off loads.
+        void ffMapSetLearning(bool learning)
         {
-            goToPosition(position);
-            delayUpdateMS(delayMS);
+            _ffMapLearning = learning;
+        }
+        bool ffMapGetLearning(void)
+        {
+            return _ffMapLearning;
         }
 
-        // Go to the specified position using PID, but wait until the motor arrives
-        void goToPositionWaitForArrival(int32_t position)
+        // The period of the map, in ticks. For loads that repeat once per turn
+        // of a geared-down output, set this to the ticks per output turn.
+        void ffMapSetPeriod(uint16_t ticks)
         {
-            goToPosition(position);
-            while( !settledAtPosition( position ) )
+            if( ticks >= BRICKTRONICS_MOTOR_FF_MAP_BINS )
             {
-                update();
+                _ffMapPeriod = ticks;
             }
         }
+        uint16_t ffMapGetPeriod(void)
+        {
+            return _ffMapPeriod;
+        }
 
-        // Same as above, but return after timeoutMS milliseconds in case it gets stuck
-        // Returns true if we made it to position, false if we had a timeout
-        bool goToPositionWaitForArrivalOrTimeout(int32_t position, uint32_t timeoutMS)
+        // Forgets everything the map has learned.
+        void ffMapClear(void)
         {
-            goToPosition(position);
-            timeoutMS += millis(); // future time when we timeout
-            while( !settledAtPosition( position ) && ( millis() < timeoutMS ) )
+            if( _ffMap )
             {
-                update();
+                memset(_ffMap, 0, sizeof(BricktronicsMotorFeedForwardMap));
             }
-            if( millis() >= timeoutMS )
+        }
+
+#if defined(__AVR__)
+        // Saves the map (and its period) to the EEPROM, taking up
+        // BRICKTRONICS_MOTOR_FF_MAP_EEPROM_SIZE bytes from address on. The map
+        // is indexed by the motor position, so after a power cycle it only
+        // lines up again if the position is zeroed at the same place, for
+        // example with setPosition(0) after homing against an end stop.
+        void ffMapSave(uint16_t address)
+        {
+            if( !_ffMap )
+            {
+                return;
+            }
+            uint8_t *p = (uint8_t *) address;
+            eeprom_update_word((uint16_t *) p, _ffMapPeriod);
+            eeprom_update_block(_ffMap->drive, p + 2, sizeof(_ffMap->drive));
+            eeprom_update_byte(p + BRICKTRONICS_MOTOR_FF_MAP_EEPROM_SIZE - 1, _ffMapChecksum(address));
+        }
+
+        // Loads a map saved with ffMapSave(). Returns false (and leaves the map
+        // alone) if there isn't a valid one at that address.
+        bool ffMapLoad(uint16_t address)
+        {
+            uint8_t *p = (uint8_t *) address;
+            if( !_ffMap || eeprom_read_byte(p + BRICKTRONICS_MOTOR_FF_MAP_EEPROM_SIZE - 1) != _ffMapChecksum(address) )
             {
                 return false;
             }
+            _ffMapPeriod = eeprom_read_word((uint16_t *) p);
+            eeprom_read_block(_ffMap->drive, p + 2, sizeof(_ffMap->drive));
             return true;
         }
+#endif
 
-        // Angle control functions - 0 - 359, handles discontinuity nicely.
-        // Can specify any angle, positive or negative. If you say 
-        // "go to angle 721" it will be the same as "go to angle 1".
-        // Similarly, "go to angle -60" will be "go to angle 300".
-        // If you want "go 45 degrees clockwise from here", try using
-        // m.goToAngle(m.getAngle() + 45);
-        // The fancy angle math is in _getDestPositionFromAngle, these functions just
-        // use the result of that function with their corresponding goToPosition*.
-        void goToAngle(int32_t angle)
+
+        // Iterative learning control functions
+        // When the motor runs through the same sequence of moves over and over,
+        // the PID makes the same tracking errors every time. Iterative learning
+        // control samples the position error every _ilcSampleTimeMS of a run,
+        // and uses it to update a drive strength correction for that part of
+        // the run. On the next run, the corrections are added to the drive
+        // strength in the position and cascaded modes, so the errors shrink
+        // from run to run. A correction is learned from the error a few
+        // samples later (the lead), since that's when its effect shows up.
+        // Call ilcStartRun() at the same point of the sequence every time,
+        // right before the first move. A run ends after
+        // BRICKTRONICS_MOTOR_ILC_SAMPLES samples, or at the next ilcStartRun().
+        // The corrections are not copied, so they need to stay around (a global
+        // variable is easiest). Use one for each different sequence, and pass
+        // NULL to stop using them.
+        void setIterativeLearning(BricktronicsMotorILC *ilc)
         {
-            goToPosition(_getDestPositionFromAngle(angle));
+            _ilc = ilc;
+            _ilcRunning = false;
+        }
+        BricktronicsMotorILC *getIterativeLearning(void)
+        {
+            return _ilc;
         }
 
-        // Go to the specified angle using PID, but wait for the specified number of milliseconds
-        void goToAngleWaitForDelay(int32_t angle, uint32_t delayMS)
+        // Starts a run (ending the last one, if it's still going).
+        void ilcStartRun(void)
         {
-            goToPositionWaitForDelay(_getDestPositionFromAngle(angle), delayMS);
+            if( _ilcRunning )
+            {
+                _ilcEndRun();
+            }
+            if( !_ilc )
+            {
+                return;
+            }
+            _ilcRunning = true;
+            _ilcIndex = 0;
+            _ilcRunStart = millis();
+            _ilcErrorSum = 0;
         }
 
-        // Go to the specified angle using PID, but wait until the motor arrives
-        void goToAngleWaitForArrival(int32_t angle)
+        // True while a run is going.
+        bool ilcRunning(void)
         {
-            goToPositionWaitForArrival(_getDestPositionFromAngle(angle));
+            return _ilcRunning;
         }
 
-        // Same as above, but return after timeoutMS milliseconds in case it gets stuck
-        // Returns true if we made it to the desired position, false if we had a timeout
-        bool goToAngleWaitForArrivalOrTimeout(int32_t angle, uint32_t timeoutMS)
+        // The mean absolute position error (in ticks) over the last finished
+        // run, to watch the learning converge.
+        uint16_t ilcGetRunError(void)
         {
-            return goToPositionWaitForArrivalOrTimeout(_getDestPositionFromAngle(angle), timeoutMS);
+            return _ilcRunError;
         }
 
-        // Returns the current angle (0-359)
-        uint16_t getAngle(void)
+        // The learning gain: drive strength added to a correction per tick of
+        // error. Higher values learn faster, but too high and the corrections
+        // start to oscillate from run to run.
+        void ilcSetGain(double gain)
         {
-            return( ( getPosition() / _angleMultiplier ) % 360 );
+            if( gain >= 0 )
+            {
+                _ilcGain = gain;
+            }
+        }
+        double ilcGetGain(void)
+        {
+            return _ilcGain;
         }
 
-        // Updates the encoder position to be the specified angle
-        void setAngle(int32_t angle)
+        // The lead, in samples, between a correction and the error it is
+        // learned from. About one time constant of the motor works well.
+        void ilcSetLead(uint8_t samples)
         {
-            setPosition( ( angle % 360 ) * _angleMultiplier );
+            if( samples > 0 )
+            {
+                _ilcLead = samples;
+            }
+        }
+        uint8_t ilcGetLead(void)
+        {
+            return _ilcLead;
         }
 
-        // For the angle control, the user can specify a different multiplier
-        // between motor encoder ticks and "output rotations", defaults to 1.
-        // Use this setting if your motor is connected to a gear train that
-        // makes a different number of motor rotations per output rotation.
-        // For example, if you have a 5:1 gear train between your motor and
-        // the final output, then you can specify this value as 5.
-        // Negative numbers should work just fine.
-        // TODO Using integer angles means we can't do sub-degree positioning,
-        // which only really becomes noticable if we scale-up the output by a lot.
-        void setAngleOutputMultiplier(int8_t multiplier)
+        // The sample time (ms). A run covers BRICKTRONICS_MOTOR_ILC_SAMPLES of
+        // these, so set this to fit your sequence in. Changing it makes the old
+        // corrections meaningless, use ilcClear().
+        void ilcSetSampleTimeMS(uint16_t sampleTimeMS)
         {
-            // Since the LEGO NXT motor encoders have 720 ticks per 360 degrees,
-            // we have to double the user's specified multiplier.
-            _angleMultiplier = multiplier << 1;
+            if( sampleTimeMS > 0 )
+            {
+                _ilcSampleTimeMS = sampleTimeMS;
+            }
+        }
+        uint16_t ilcGetSampleTimeMS(void)
+        {
+            return _ilcSampleTimeMS;
         }
 
+        // Forgets all the corrections.
+        void ilcClear(void)
+        {
+            if( _ilc )
+            {
+                memset(_ilc, 0, sizeof(BricktronicsMotorILC));
+            }
+        }
 
 
-    //private:
-        // We really don't like to hide things inside private,
-        // but if we did, these would be the private items.
-        uint8_t _enPin;
-        uint8_t _dirPin;
-        uint8_t _pwmPin;
+        // State estimator functions
+        // An estimator gives smoothed estimates of the motor's position, speed
+        // and acceleration, and is sampled from update(). While one is attached,
+        // the speed loop, the minimum-time moves and the gain schedule use its
+        // speed instead of measuring their own, settledAtPosition() also checks
+        // that the motor has stopped, and the stall detection below works.
+        // The estimator is not copied, so it needs to stay around (a global
+        // variable is easiest). Pass NULL to stop using it.
+        void setEstimator(BricktronicsEstimator *estimator)
+        {
+            _estimator = estimator;
+            _stallSince = millis();
+            _stalled = false;
+            // The disturbance observer starts over with the new estimator
+            // (or stops, without one)
+            _dobDisturbance = 0;
+            if( _estimator )
+            {
+                _estimator->reset(_encoder.read(), micros());
+            }
+        }
+        BricktronicsEstimator *getEstimator(void)
+        {
+            return _estimator;
+        }
 
-        uint8_t _mode;
-        uint16_t _rawSpeed;
+        // Disturbance observer functions
+        // The disturbance observer estimates the load on the motor (as the drive
+        // strength it takes away) from the drive strength we send and the speed
+        // and acceleration from the estimator, using the step response model:
+        // speed + timeConstant * acceleration = gain * (drive - load).
+        // The estimated load is added to the drive strength in the position,
+        // speed and cascaded modes, so a sudden load (like picking something up)
+        // is cancelled out within a few filter time constants, instead of
+        // waiting for the PID integral term to catch up. Needs an estimator, and
+        // works best with a model from sysidStepResponse() (without one, it uses
+        // a model of an unloaded NXT motor).
+        void setDisturbanceObserver(bool enable)
+        {
+            _dobEnabled = enable;
+            _dobDisturbance = 0;
+        }
+        bool getDisturbanceObserver(void)
+        {
+            return _dobEnabled;
+        }
 
-        // PID variables
-        PID _pid;
-        double _pidSetpoint, _pidInput, _pidOutput;
-        double _pidKp, _pidKi, _pidKd;
+        // Set the time constant (milliseconds) of the low-pass filter on the
+        // load estimate. Shorter rejects loads faster, but lets more of the
+        // estimator's noise through to the motor. Defaults to 20.
+        void dobSetFilterTimeMS(uint16_t timeMS)
+        {
+            _dobFilterTimeMS = timeMS;
+        }
 
-        // Tracks the position of the motor
-        Encoder _encoder;
+        // The current load estimate, as a drive strength.
+        int16_t dobGetDisturbance(void)
+        {
+            return _dobDisturbance;
+        }
 
-        // Check out the comments above for setAngleOutputMultiplier()
-        int8_t _angleMultiplier;
 
-        // Raw, uncontrolled speed settings
-        // There is no monitoring or control of the speed here,
-        // just set a fixed drive strength between -255 and +255.
-        // Be sure to check out coast(), brake(), and hold().
-        void _rawSetSpeed(int16_t s)
+        // Backlash compensation functions
+        // The gears between the motor (where the encoder is) and the output have
+        // some slop, so when the motor changes direction it has to turn a few
+        // ticks before the output starts moving. With the backlash width set,
+        // we keep track of which side of the slop the gears are pushing on, and
+        // goToPosition() and friends aim the motor half the width past the
+        // position on that side, so the output ends up at the position however
+        // it got there. When the motor overshoots and comes back, the gears
+        // switch sides and the motor setpoint moves along with them.
+        // settledAtPosition() checks the output position, but getPosition()
+        // still returns the motor position.
+        void setBacklash(uint8_t ticks)
         {
-            if( _reversed )
+            _backlash = ticks;
+            _backlashOutput = getPosition() - _backlashSide * ( _backlash / 2 );
+        }
+        uint8_t getBacklash(void)
+        {
+            return _backlash;
+        }
+
+        // Measures the backlash width by driving the motor one way until it
+        // stalls, then the other way until it stalls again, and sets the width
+        // to the distance in between. The output has to be held in place in
+        // both directions while this runs (clamp it, or let it rest against a
+        // stop on each side), so only the slop in the gears can move. Drives
+        // the motor at the given strength, or the stall detection threshold
+        // if that is higher. Uses the estimator if one is attached, or a
+        // temporary one otherwise. This blocks until both stalls are found,
+        // the motor brakes when done. Returns false (and leaves the backlash
+        // alone) if the motor doesn't stall in time.
+        bool backlashCalibrate(uint8_t drive)
+        {
+            BricktronicsEstimator temporary;
+            BricktronicsEstimator *attached = _estimator;
+            if( !attached )
             {
-                s = -s;
+                setEstimator(&temporary);
             }
-
-            if( s < 0 )
+            if( drive < _stallDrive )
             {
-                _digitalWrite(_dirPin, HIGH);
-                analogWrite(_pwmPin, 255 + s);
+                drive = _stallDrive;
             }
-            else
+
+            int32_t ends[2];
+            bool success = true;
+            for( uint8_t i = 0; i < 2 && success; i++ )
             {
-                _digitalWrite(_dirPin, LOW);
-                analogWrite(_pwmPin, s);
+                setFixedDrive(( i == 0 ) ? drive : -drive);
+                _stallSince = millis();
+                _stalled = false;
+                unsigned long start = millis();
+                while( !_stalled )
+                {
+                    update();
+                    if( millis() - start >= BRICKTRONICS_MOTOR_BACKLASH_TIMEOUT_MS )
+                    {
+                        success = false;
+                        break;
+                    }
+                }
+                ends[i] = _encoder.read();
             }
+            brake();
 
-            // Enable drivers
-            _digitalWrite(_enPin, HIGH);
+            setEstimator(attached);
+            if( success )
+            {
+                // We finished by pushing the motor backwards against the output
+                _backlashSide = -1;
+                setBacklash(min(abs(ends[0] - ends[1]), 255));
+            }
+            return success;
         }
 
-        // If you reverse the speed/direction pins, the motor runs backwards.
-        // Use this value to switch how your speed settings are applied.
-        // See _rawSetSpeed above.
-        // The Bricktronics Shield has the speed/direction signals reversed
-        // from the canonical naming used on the Bricktronics Motor Driver and
+
+        // Load encoder functions
+        // The gears between the motor and the output have slop, and long
+        // axles and beams twist, so the motor encoder doesn't quite tell where
+        // the output is. A second encoder on the output shaft (the load
+        // encoder) does, but closing the position loop on it alone makes the
+        // loop ring, since the slop sits between the motor and what it sees.
+        // So the position loop sees the motor position plus the difference
+        // between the load and motor positions, low-pass filtered: quick
+        // changes (and the PID's damping) come from the motor encoder, and
+        // where it settles comes from the load encoder. The speed loop and the
+        // estimator keep using the motor encoder. Both encoders are read
+        // together, once per update().
+        // motorTicksPerLoadTick converts load encoder ticks to motor ticks, so
+        // all positions stay in motor ticks. For example, with an NXT motor
+        // geared down 3:1 to an axle that turns another NXT motor as the load
+        // encoder, it's 3.
+        // The encoder is not copied, so it needs to stay around (a global
+        // variable is easiest). Pass NULL to stop using it.
+        void setLoadEncoder(Encoder *encoder, double motorTicksPerLoadTick)
+        {
+            _loadEncoder = encoder;
+            if( !_loadEncoder )
+            {
+                return;
+            }
+            _loadScale = motorTicksPerLoadTick * 4096;
+            _loadRemainder = 0;
+            _loadOffset = 0;
+            _loadFilterLast = millis();
+            Encoder::readPair(_encoder, *_loadEncoder, &_loadMotorPosition, &_loadLast);
+            _loadPosition = _loadMotorPosition;
+        }
+        Encoder *getLoadEncoder(void)
+        {
+            return _loadEncoder;
+        }
+
+        // The time constant (ms) of the filter on the difference between the
+        // load and motor positions. Shorter tracks the slop better as the motor
+        // changes direction, but gives less damping. Defaults to 50.
+        void loadEncoderSetFilterTimeMS(uint16_t timeMS)
+        {
+            // At least 1, or the filter would never move
+            _loadAlpha = timeMS < 65535 ? 65535UL / ( timeMS + 1 ) : 1;
+        }
+
+        // The load position, in motor ticks. It starts out the same as the
+        // motor position when the load encoder is attached, and both are
+        // changed by setPosition().
+        int32_t getLoadPosition(void)
+        {
+            return _loadEncoder ? _loadPosition : getPosition();
+        }
+
+
+        // Stall detection functions
+        // Returns true when the motor is being driven hard but isn't moving,
+        // for example when it has run into something. Needs an estimator.
+        bool isStalled(void)
+        {
+            return _stalled;
+        }
+
+        // The motor is stalled after being driven at least drive strength, while
+        // moving slower than speed (ticks per second), for timeMS milliseconds.
+        void stallSetThresholds(uint8_t drive, uint16_t speed, uint16_t timeMS)
+        {
+            _stallDrive = drive;
+            _stallSpeed = speed;
+            _stallTimeMS = timeMS;
+        }
+
+
+        // Trace functions
+        // Printing from the control loop is too slow to catch what happens
+        // when something goes wrong, so instead the motor can keep the last
+        // size control loop samples (setpoint, input, output, mode and
+        // micros()) in a ring buffer in RAM, and stop recording a little
+        // after a trigger. Then print it with traceDump() at your leisure.
+        // Each sample is 16 bytes, so keep it small on an Uno. The samples
+        // are not copied, so they need to stay around (a global variable is
+        // easiest). Pass NULL (or a size of 0) to stop tracing.
+        void traceBegin(BricktronicsMotorTraceSample *samples, uint16_t size)
+        {
+            _trace = size ? samples : NULL;
+            _traceSize = size;
+            traceArm();
+        }
+
+        // Stops recording afterSamples samples after any of conditions
+        // (BRICKTRONICS_MOTOR_TRACE_TRIGGER_*) happens: a stall (which needs an
+        // estimator), the control error getting bigger than errorThreshold,
+        // or the drive strength maxing out. With no conditions, it keeps
+        // recording until traceTrigger(). The default is to keep half of the
+        // trace from after the trigger.
+        void traceSetTrigger(uint8_t conditions, uint16_t errorThreshold, uint16_t afterSamples)
+        {
+            _traceConditions = conditions;
+            _traceErrorThreshold = errorThreshold;
+            _traceAfter = afterSamples;
+        }
+        void traceSetTrigger(uint8_t conditions, uint16_t errorThreshold)
+        {
+            traceSetTrigger(conditions, errorThreshold, _traceSize / 2);
+        }
+
+        // Throws away the trace and starts recording again
+        void traceArm(void)
+        {
+            _traceHead = 0;
+            _traceCount = 0;
+            _traceTriggered = false;
+            _traceRemaining = 0;
+        }
+
+        // Sets off the trigger by hand
+        void traceTrigger(void)
+        {
+            if( !_traceTriggered )
+            {
+                _traceTriggered = true;
+                _traceTriggerUS = micros();
+                _traceRemaining = _traceAfter;
+            }
+        }
+
+        // Whether the trigger has gone off, and whether the trace is done
+        // recording afterwards
+        bool traceTriggered(void)
+        {
+            return _traceTriggered;
+        }
+        bool traceDone(void)
+        {
+            return _traceTriggered && _traceRemaining == 0;
+        }
+
+        // The number of samples in the trace, and sample index of them (0 is
+        // the oldest). Returns false if there's no such sample.
+        uint16_t traceGetCount(void)
+        {
+            return _traceCount;
+        }
+        bool traceGetSample(uint16_t index, BricktronicsMotorTraceSample *sample)
+        {
+            if( index >= _traceCount )
+            {
+                return false;
+            }
+            uint16_t i = _traceHead + _traceSize - _traceCount + index;
+            if( i >= _traceSize )
+            {
+                i -= _traceSize;
+            }
+            *sample = _trace[i];
+            return true;
+        }
+
+        // Prints the trace, oldest first, one sample per line:
+        // time (microseconds, from the trigger if it went off), setpoint,
+        // input, output, mode, flags. This takes a while, so do it once the
+        // trace is done.
+        void traceDump(Print &output)
+        {
+            output.println("time,setpoint,input,output,mode,flags");
+            BricktronicsMotorTraceSample sample;
+            for( uint16_t i = 0; traceGetSample(i, &sample); i++ )
+            {
+                output.print( _traceTriggered ? (long) ( sample.timeUS - _traceTriggerUS ) : (long) sample.timeUS );
+                output.print(',');
+                output.print(sample.setpoint);
+                output.print(',');
+                output.print(sample.input);
+                output.print(',');
+                output.print(sample.output);
+                output.print(',');
+                output.print(sample.mode);
+                output.print(',');
+                output.println(sample.flags);
+            }
+        }
+
+
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+        // Timing functions, only with BRICKTRONICS_MOTOR_TIMING (see the top
+        // of this file). Every update() adds how long it took to one
+        // histogram, and every control loop sample adds how late it ran
+        // (the time since the last sample, minus the sample time) to
+        // another, all in microseconds. The clock is the fastest one the board
+        // has, see utility/BricktronicsTiming.h.
+        BricktronicsTimingHistogram *timingGetUpdate(void)
+        {
+            return &_timingUpdate;
+        }
+        BricktronicsTimingHistogram *timingGetInterval(void)
+        {
+            return &_timingInterval;
+        }
+
+        // The number of control loop samples that ran more than lateUS late
+        // (defaults to 1000)
+        uint32_t timingGetLate(void)
+        {
+            return _timingLate;
+        }
+        void timingSetLateUS(uint16_t lateUS)
+        {
+            _timingLateUS = lateUS;
+        }
+
+        // Starts the histograms and the late count over
+        void timingReset(void)
+        {
+            BricktronicsTiming::clear(&_timingUpdate);
+            BricktronicsTiming::clear(&_timingInterval);
+            _timingLate = 0;
+            _timingMode = _mode;
+            _timingHaveSample = false;
+        }
+
+        // Prints both histograms and the late count
+        void timingPrint(Print &output)
+        {
+            output.print("update ");
+            BricktronicsTiming::print(output, &_timingUpdate);
+            output.print("interval ");
+            BricktronicsTiming::print(output, &_timingInterval);
+            output.print("late ");
+            output.println(_timingLate);
+        }
+#endif
+
+
+        // Relay autotune functions
+        // Starts a relay-feedback (Astrom-Hagglund) autotune of the position PID
+        // around the current position. The motor is driven at +relayDrive or
+        // -relayDrive depending on which side of the starting position it is on,
+        // which makes it oscillate. From the size and period of that oscillation
+        // we get the ultimate gain and period, and use the tuning rule to pick new
+        // PID tunings, which are applied with pidSetTunings(). Make sure the motor
+        // is free to swing back and forth a bit, and that relayDrive is enough to
+        // overcome the friction of your load. This doesn't block, so keep calling
+        // update() and check autotuneGetStatus(). When the autotune finishes,
+        // the motor holds the starting position. Calling any of the other motor
+        // functions that change the mode will stop the autotune.
+        void autotuneStart(uint8_t relayDrive, uint8_t rule)
+        {
+            _autotuneSetpoint = _encoder.read();
+            _autotuneDrive = relayDrive;
+            _autotuneRule = rule;
+            _autotuneDriveUp = true;
+            _autotuneCycles = 0;
+            _autotuneMax = _autotuneSetpoint;
+            _autotuneMin = _autotuneSetpoint;
+            _autotuneAmplitudeSum = 0;
+            _autotuneLastSwitch = millis();
+            _autotuneLastSample = _autotuneLastSwitch;
+            _autotuneStatus = BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_RUNNING;
+            _mode = BRICKTRONICS_MOTOR_MODE_AUTOTUNE;
+            _rawSetSpeed(_autotuneDrive);
+        }
+
+        // Returns one of the BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_* values.
+        uint8_t autotuneGetStatus(void)
+        {
+            if(    _autotuneStatus == BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_RUNNING
+                && _mode != BRICKTRONICS_MOTOR_MODE_AUTOTUNE )
+            {
+                // Someone switched to another mode before we were done
+                return BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_IDLE;
+            }
+            return _autotuneStatus;
+        }
+
+        // The measured ultimate gain (drive strength per tick) and period, these
+        // are only valid after an autotune has finished successfully.
+        double autotuneGetUltimateGain(void)
+        {
+            return _autotuneKu;
+        }
+        uint16_t autotuneGetUltimatePeriodMS(void)
+        {
+            return _autotuneTuMS;
+        }
+
+        // Computes the PID tunings from the last measured ultimate gain and period
+        // using a different tuning rule, and applies them with pidSetTunings().
+        // Handy to try out a few rules without running the autotune again.
+        void autotuneApplyRule(uint8_t rule)
+        {
+            // Each rule gives Kp as a fraction of Ku, and the integral and
+            // derivative times as a fraction of Tu (0 means no D term).
+            double kpRatio, tiRatio, tdRatio;
+            switch( rule )
+            {
+                case BRICKTRONICS_MOTOR_AUTOTUNE_RULE_ZIEGLER_NICHOLS_PI:
+                    kpRatio = 0.45; tiRatio = 0.833; tdRatio = 0;
+                    break;
+                case BRICKTRONICS_MOTOR_AUTOTUNE_RULE_TYREUS_LUYBEN:
+                    kpRatio = 0.454; tiRatio = 2.2; tdRatio = 0.159;
+                    break;
+                case BRICKTRONICS_MOTOR_AUTOTUNE_RULE_SOME_OVERSHOOT:
+                    kpRatio = 0.33; tiRatio = 0.5; tdRatio = 0.333;
+                    break;
+                case BRICKTRONICS_MOTOR_AUTOTUNE_RULE_NO_OVERSHOOT:
+                    kpRatio = 0.2; tiRatio = 0.5; tdRatio = 0.333;
+                    break;
+                case BRICKTRONICS_MOTOR_AUTOTUNE_RULE_ZIEGLER_NICHOLS:
+                default:
+                    kpRatio = 0.6; tiRatio = 0.5; tdRatio = 0.125;
+                    break;
+            }
+            double Tu = _autotuneTuMS / 1000.0;
+            double Kp = kpRatio * _autotuneKu;
+            pidSetTunings(Kp, Kp / (tiRatio * Tu), Kp * tdRatio * Tu);
+        }
+
+
+        // Raw, uncontrolled speed settings
+        // There is no monitoring or control of the speed here,
+        // just set a fixed drive strength between -255 and +255 (0 = brake).
+        void setFixedDrive(int16_t s)
+        {
+            _mode = BRICKTRONICS_MOTOR_MODE_FIXED_DRIVE;
+            _rawSpeed = s;
+            _rawSetSpeed(_rawSpeed);
+        }
+
+        // Retrieves the previously-set fixed drive speed
+        int16_t getFixedDrive(void)
+        {
+            return _rawSpeed;
+        }
+
+
+        // Step response identification functions
+        // Brakes the motor, then drives it at a fixed drive strength and records
+        // the encoder position at a high rate for durationMS milliseconds. From that
+        // we fit a first-order-plus-dead-time model of how the motor speed responds
+        // to the drive strength: the gain (ticks per second per unit of drive),
+        // the time constant and the dead time. The motor brakes when done.
+        // This blocks for about durationMS (plus a short rest before the step), and
+        // the motor will turn quite a bit, so make sure it's free to move. The
+        // duration should be long enough for the motor to get up to speed, at
+        // least five times the time constant. Returns false if the motor didn't
+        // move enough to fit a model, or moved more than 32767 ticks (the
+        // samples are 16 bits), so keep the duration to a few seconds. Uses two
+        // bytes of stack per sample while running.
+        bool sysidStepResponse(uint8_t drive, uint16_t durationMS)
+        {
+            int16_t samples[BRICKTRONICS_MOTOR_SYSID_SAMPLES];
+            unsigned long sampleTimeUS = (unsigned long) durationMS * 1000 / BRICKTRONICS_MOTOR_SYSID_SAMPLES;
+
+            brake();
+            delay(BRICKTRONICS_MOTOR_SYSID_REST_MS);
+
+            _mode = BRICKTRONICS_MOTOR_MODE_FIXED_DRIVE;
+            _rawSpeed = drive;
+            int32_t start = _encoder.read();
+            unsigned long stepTime = micros();
+            _rawSetSpeed(drive);
+            for( uint8_t i = 0; i < BRICKTRONICS_MOTOR_SYSID_SAMPLES; i++ )
+            {
+                // Sample i is taken at the end of interval i
+                while( micros() - stepTime < ( i + 1 ) * sampleTimeUS )
+                {
+                    // wait
+                }
+                int32_t moved = _encoder.read() - start;
+                if( moved > 32767 || moved < -32767 )
+                {
+                    brake();
+                    return false;
+                }
+                samples[i] = moved;
+            }
+            brake();
+
+            return _fitStepResponse(samples, drive, sampleTimeUS);
+        }
+
+        // The fitted model, only valid after a successful sysidStepResponse()
+        double sysidGetGain(void)
+        {
+            return _modelGain;
+        }
+        uint16_t sysidGetTimeConstantMS(void)
+        {
+            return _modelTimeConstantMS;
+        }
+        uint16_t sysidGetDelayMS(void)
+        {
+            return _modelDelayMS;
+        }
+
+        // Computes tunings for both the speed PID and the position PID from the
+        // fitted model and applies them. The speed loop uses an IMC (lambda) PI
+        // tuning that aims for the motor's own time constant, which pairs well
+        // with sysidSetFeedForward() below. The position loop uses the SIMC rules
+        // for an integrating process with a lag, aiming for a quarter of the
+        // time constant. Neither loop aims for faster than its dead time, and
+        // the delay of each loop's own sample time is added to the dead time, so
+        // call pidSetUpdateFrequencyMS() and speedPidSetUpdateFrequencyMS()
+        // first if you want to change them.
+        void sysidApplyTunings(void)
+        {
+            if( _modelGain <= 0 )
+            {
+                return;
+            }
+            double tau = _modelTimeConstantMS / 1000.0;
+
+            // Speed loop: plant is K * e^(-theta*s) / (tau*s + 1)
+            double theta = ( _modelDelayMS + _speedSampleTimeMS ) / 1000.0;
+            double lambda = max(tau, theta);
+            double Kp = tau / ( _modelGain * ( lambda + theta ) );
+            speedPidSetTunings(Kp, Kp / tau, 0);
+
+            // Position loop: plant is K * e^(-theta*s) / (s * (tau*s + 1)).
+            // SIMC gives a series-form PID, which we convert to the parallel
+            // form used by the PID library.
+            theta = ( _modelDelayMS + _pidSampleTimeMS / 2 ) / 1000.0;
+            lambda = max(tau / 4, theta);
+            double Kc = 1.0 / ( _modelGain * ( lambda + theta ) );
+            double Ti = 4 * ( lambda + theta );
+            double Td = tau;
+            Kp = Kc * ( 1 + Td / Ti );
+            pidSetTunings(Kp, Kp / ( Ti + Td ), Kp * Ti * Td / ( Ti + Td ));
+        }
+
+        // When enabled, the speed loop adds the drive strength that the fitted
+        // model says is needed for the desired speed (speed / gain) to the PID
+        // output, so the PID only needs to correct for the model's mistakes.
+        // Together with the gentler speed tunings from sysidApplyTunings(), this
+        // makes the speed mode (and the cascaded mode) respond faster. With the
+        // default, more aggressive speed tunings it tends to overshoot instead.
+        void sysidSetFeedForward(bool enable)
+        {
+            _modelFeedForward = enable;
+        }
+
+
+        // Speed control functions
+        // Uses the speed PID loop to hold the motor at the specified speed,
+        // in encoder ticks per second (720 ticks per revolution). Negative
+        // speeds run the motor backwards. You need to periodically call update().
+        void setSpeed(int16_t ticksPerSecond)
+        {
+            if( _mode != BRICKTRONICS_MOTOR_MODE_PID_SPEED )
+            {
+                _startSpeedLoop();
+                _mode = BRICKTRONICS_MOTOR_MODE_PID_SPEED;
+            }
+            _speedPidSetpoint = ticksPerSecond;
+        }
+
+        // Returns the most recent speed measured by the speed loop, in ticks per second.
+        // This is only updated while in the speed, cascaded position or
+        // minimum-time modes, unless an estimator is attached, in which case
+        // this is always the estimated speed.
+        int16_t getSpeed(void)
+        {
+            if( _estimator )
+            {
+                return _estimator->getSpeed();
+            }
+            return _speedPidInput;
+        }
+
+        // Update the maximum frequency at which the speed PID loop will actually update.
+        // For cascaded control, this should be faster than pidSetUpdateFrequencyMS().
+        void speedPidSetUpdateFrequencyMS(int timeMS)
+        {
+            _speedSampleTimeMS = timeMS;
+            _speedPid.SetSampleTime(timeMS);
+        }
+
+        // Functions for getting and setting the speed PID tuning parameters
+        double speedPidGetKp(void)
+        {
+            return _speedPidKp;
+        }
+        double speedPidGetKi(void)
+        {
+            return _speedPidKi;
+        }
+        double speedPidGetKd(void)
+        {
+            return _speedPidKd;
+        }
+        void speedPidSetTunings(double Kp, double Ki, double Kd)
+        {
+            _speedPidKp = Kp;
+            _speedPidKi = Ki;
+            _speedPidKd = Kd;
+            _speedPid.SetTunings(_speedPidKp, _speedPidKi, _speedPidKd);
+        }
+
+
+        // Cascaded position control
+        // When enabled, all the goToPosition* and goToAngle* functions (and hold())
+        // use two nested loops instead of the single position PID: the outer
+        // position loop (_pid) produces a speed command, and the inner speed loop
+        // (_speedPid) produces the motor drive strength. This gives a stiffer and
+        // faster position control, especially with a load on the motor.
+        // The outer loop is the position controller with the cascade tunings,
+        // which only makes sense for the PID controllers. With any other
+        // controller, this returns false and leaves cascaded control off.
+        bool setCascadeControl(bool enable)
+        {
+            if( enable && !Controller::PIDTunings )
+            {
+                return false;
+            }
+            if( enable == _cascade )
+            {
+                return true;
+            }
+            _cascade = enable;
+            // The outer loop output changes units (drive strength vs speed),
+            // so restart it from zero instead of keeping the old integral term.
+            _pidOutput = 0;
+            _pid.SetMode(MANUAL);
+            _pid.SetMode(AUTOMATIC);
+            if( _cascade )
+            {
+                _pid.SetOutputLimits(-_cascadeMaxSpeed, _cascadeMaxSpeed);
+            }
+            else
+            {
+                _pid.SetOutputLimits(-255, +255);
+            }
+            pidUpdateTunings();
+            if( _mode == BRICKTRONICS_MOTOR_MODE_PID_POSITION || _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+            {
+                _goToMotorPosition(_pidSetpoint);
+            }
+            return true;
+        }
+        bool getCascadeControl(void)
+        {
+            return _cascade;
+        }
+
+        // Set the outer position loop tuning parameters for cascaded control.
+        // The outer loop is a PI loop, its output is in ticks per second.
+        void cascadeSetTunings(double Kp, double Ki)
+        {
+            _cascadeKp = Kp;
+            _cascadeKi = Ki;
+            pidUpdateTunings();
+        }
+
+        // Set the fastest speed (ticks per second) the outer position loop will
+        // ask of the inner speed loop while moving to a position.
+        void cascadeSetMaxSpeed(int16_t ticksPerSecond)
+        {
+            _cascadeMaxSpeed = ticksPerSecond;
+            if( _cascade )
+            {
+                _pid.SetOutputLimits(-_cascadeMaxSpeed, _cascadeMaxSpeed);
+            }
+        }
+
+
+        // Position control functions
+        void goToPosition(int32_t position)
+        {
+            if( _shaperType != BRICKTRONICS_MOTOR_SHAPER_NONE )
+            {
+                _shaperGoTo(position);
+                return;
+            }
+            _goToMotorPosition(_backlashCompensate(position));
+        }
+
+        // Go to the specified position using PID, but wait for the specified number of milliseconds
+        void goToPositionWaitForDelay(int32_t position, uint32_t delayMS)
+        {
+            goToPosition(position);
+            delayUpdateMS(delayMS);
+        }
+
+        // Go to the specified position using PID, but wait until the motor arrives
+        void goToPositionWaitForArrival(int32_t position)
+        {
+            goToPosition(position);
+            while( !settledAtPosition( position ) )
+            {
+                update();
+            }
+        }
+
+        // Same as above, but return after timeoutMS milliseconds in case it gets stuck
+        // Returns true if we made it to position, false if we had a timeout
+        bool goToPositionWaitForArrivalOrTimeout(int32_t position, uint32_t timeoutMS)
+        {
+            goToPosition(position);
+            timeoutMS += millis(); // future time when we timeout
+            while( !settledAtPosition( position ) && ( millis() < timeoutMS ) )
+            {
+                update();
+            }
+            if( millis() >= timeoutMS )
+            {
+                return false;
+            }
+            return true;
+        }
+
+        // Minimum-time position control functions
+        // For short point-to-point moves, this gets there faster than the PID.
+        // The motor drives at full strength towards the position, then at full
+        // strength in reverse to brake, switching over when the braking distance
+        // for the current speed (from the switching curve) reaches the distance
+        // left to go. Once the motor stops near the destination, it hands off
+        // to goToPosition() to settle. The switching curve comes from
+        // the step response model when sysidStepResponse() has been run, and from
+        // a model of an unloaded motor otherwise, so run that with your load
+        // connected for the best results. You need to call update() as often as
+        // you can during the move (not just every few milliseconds), because the
+        // braking point is checked on every call.
+        void goToPositionMinTime(int32_t position)
+        {
+            _pidSetpoint = _backlashCompensate(position);
+            _speedLastPosition = _encoder.read();
+            _speedLastTime = millis();
+            _speedPidInput = 0;
+            _minTimeBraking = false;
+            _mode = BRICKTRONICS_MOTOR_MODE_MIN_TIME;
+            _updateMinTime();
+        }
+
+        // Same as goToPositionWaitForArrivalOrTimeout(), but with a minimum-time move.
+        bool goToPositionMinTimeWaitForArrivalOrTimeout(int32_t position, uint32_t timeoutMS)
+        {
+            goToPositionMinTime(position);
+            timeoutMS += millis(); // future time when we timeout
+            while( !settledAtPosition( position ) && ( millis() < timeoutMS ) )
+            {
+                update();
+            }
+            if( millis() >= timeoutMS )
+            {
+                return false;
+            }
+            return true;
+        }
+
+        // How close (in ticks) to the destination the minimum-time move
+        // hands off to the position PID. Defaults to 4.
+        void minTimeSetHandoffDistance(uint16_t ticks)
+        {
+            _minTimeHandoff = ticks;
+        }
+
+        // Input shaping functions
+        // A long beam or other springy load on the motor rings after every move.
+        // The input shaper splits each move into two (ZV) or three (ZVD) smaller
+        // steps, spaced half a period of the vibration apart and sized so the
+        // ringing from each step cancels out the others. Moves take an extra
+        // half period (ZV) or full period (ZVD) to finish, but there's no need
+        // to wait for the ringing to die down afterwards. ZVD is a bit slower,
+        // but still works when the frequency is off by 20% or so.
+        // The frequency (Hz) and damping ratio (0 for no damping, usually under
+        // 0.1 for LEGO beams) are those of the load's vibration, which you can
+        // measure by timing a few swings after a move without shaping.
+        // goToPosition() (and the functions built on it) are shaped, the
+        // minimum-time moves and hold() are not.
+        void setInputShaper(uint8_t type, double frequencyHz, double damping)
+        {
+            if( type != BRICKTRONICS_MOTOR_SHAPER_NONE && ( frequencyHz <= 0 || damping < 0 || damping >= 1 ) )
+            {
+                return;
+            }
+            if( _shaperActive )
+            {
+                // Finish the current move right away
+                _shaperActive = false;
+                _goToMotorPosition(_backlashCompensate(_shaperInput));
+            }
+            _shaperType = type;
+            if( type == BRICKTRONICS_MOTOR_SHAPER_NONE )
+            {
+                return;
+            }
+
+            double root = sqrt(1 - damping * damping);
+            double K = exp(-damping * PI / root);
+            if( type == BRICKTRONICS_MOTOR_SHAPER_ZV )
+            {
+                _shaperA1 = K / ( 1 + K );
+                _shaperA2 = 0;
+            }
+            else
+            {
+                _shaperA1 = 2 * K / ( ( 1 + K ) * ( 1 + K ) );
+                _shaperA2 = K * K / ( ( 1 + K ) * ( 1 + K ) );
+            }
+            // Half of the damped period, split into the tap spacing
+            _shaperSampleUS = 500000.0 / ( frequencyHz * root * BRICKTRONICS_MOTOR_SHAPER_TAP_SPACING );
+        }
+        uint8_t getInputShaper(void)
+        {
+            return _shaperType;
+        }
+
+        // Angle control functions - 0 - 359, handles discontinuity nicely.
+        // Can specify any angle, positive or negative. If you say 
+        // "go to angle 721" it will be the same as "go to angle 1".
+        // Similarly, "go to angle -60" will be "go to angle 300".
+        // If you want "go 45 degrees clockwise from here", try using
+        // m.goToAngle(m.getAngle() + 45);
+        // The fancy angle math is in _getDestPositionFromAngle, these functions just
+        // use the result of that function with their corresponding goToPosition*.
+        void goToAngle(int32_t angle)
+        {
+            goToPosition(_getDestPositionFromAngle(angle));
+        }
+
+        // Go to the specified angle using PID, but wait for the specified number of milliseconds
+        void goToAngleWaitForDelay(int32_t angle, uint32_t delayMS)
+        {
+            goToPositionWaitForDelay(_getDestPositionFromAngle(angle), delayMS);
+        }
+
+        // Go to the specified angle using PID, but wait until the motor arrives
+        void goToAngleWaitForArrival(int32_t angle)
+        {
+            goToPositionWaitForArrival(_getDestPositionFromAngle(angle));
+        }
+
+        // Same as above, but return after timeoutMS milliseconds in case it gets stuck
+        // Returns true if we made it to the desired position, false if we had a timeout
+        bool goToAngleWaitForArrivalOrTimeout(int32_t angle, uint32_t timeoutMS)
+        {
+            return goToPositionWaitForArrivalOrTimeout(_getDestPositionFromAngle(angle), timeoutMS);
+        }
+
+        // Returns the current angle (0-359)
+        uint16_t getAngle(void)
+        {
+            return( ( getPosition() / _angleMultiplier ) % 360 );
+        }
+
+        // Updates the encoder position to be the specified angle
+        void setAngle(int32_t angle)
+        {
+            setPosition( ( angle % 360 ) * _angleMultiplier );
+        }
+
+        // For the angle control, the user can specify a different multiplier
+        // between motor encoder ticks and "output rotations", defaults to 1.
+        // Use this setting if your motor is connected to a gear train that
+        // makes a different number of motor rotations per output rotation.
+        // For example, if you have a 5:1 gear train between your motor and
+        // the final output, then you can specify this value as 5.
+        // Negative numbers should work just fine.
+        // TODO Using integer angles means we can't do sub-degree positioning,
+        // which only really becomes noticable if we scale-up the output by a lot.
+        void setAngleOutputMultiplier(int8_t multiplier)
+        {
+            // Since the LEGO NXT motor encoders have 720 ticks per 360 degrees,
+            // we have to double the user's specified multiplier.
+            _angleMultiplier = multiplier << 1;
+        }
+
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        uint8_t _enPin;
+        uint8_t _dirPin;
+        uint8_t _pwmPin;
+
+        uint8_t _mode;
+        uint16_t _rawSpeed;
+
+        // Position controller (PID by default) variables
+        Controller _pid;
+        double _pidSetpoint, _pidInput, _pidOutput;
+        double _pidKp, _pidKi, _pidKd;
+        uint16_t _pidSampleTimeMS;
+
+        // Speed PID variables, the input is the measured speed in ticks per second
+        PID _speedPid;
+        double _speedPidSetpoint, _speedPidInput, _speedPidOutput;
+        double _speedPidKp, _speedPidKi, _speedPidKd;
+        uint16_t _speedSampleTimeMS;
+        int32_t _speedLastPosition;
+        unsigned long _speedLastTime;
+
+        // Cascaded control variables, see setCascadeControl()
+        bool _cascade;
+        double _cascadeKp, _cascadeKi;
+        int16_t _cascadeMaxSpeed;
+
+        // Gain scheduling variables, see setGainSchedule()
+        BricktronicsMotorGainSchedule *_gainSchedule;
+        int32_t _gainScheduleLastInput;
+
+        // Minimum-time move variables, see goToPositionMinTime(). The switching
+        // curve holds the braking distance (in eighths of a tick) at evenly
+        // spaced speeds, _minTimeCurveStep ticks per second apart.
+        uint16_t _minTimeCurve[BRICKTRONICS_MOTOR_MIN_TIME_CURVE_POINTS];
+        uint16_t _minTimeCurveStep;
+        uint16_t _minTimeHandoff;
+        bool _minTimeBraking;
+        int32_t _minTimeClosest;
+
+        // State estimator and stall detection variables, see setEstimator().
+        // _drive is the drive strength last sent to the motor, and
+        // _controlSamples counts the times the control loop worked it out
+        // (for telemetry).
+        BricktronicsEstimator *_estimator;
+        int16_t _drive;
+        uint16_t _controlSamples;
+        uint8_t _stallDrive;
+        uint16_t _stallSpeed;
+        uint16_t _stallTimeMS;
+        unsigned long _stallSince;
+        bool _stalled;
+
+        // Trace variables, see traceBegin(). _traceHead is where the next
+        // sample goes, and _traceRemaining counts down the samples left to
+        // record after the trigger.
+        BricktronicsMotorTraceSample *_trace;
+        uint16_t _traceSize;
+        uint16_t _traceHead;
+        uint16_t _traceCount;
+        uint8_t _traceConditions;
+        uint16_t _traceErrorThreshold;
+        uint16_t _traceAfter;
+        uint16_t _traceRemaining;
+        bool _traceTriggered;
+        unsigned long _traceTriggerUS;
+
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+        // Timing variables, see timingReset(). _timingLastSample is when the
+        // update() with the last control loop sample started, in ticks, and
+        // _timingMode the mode it was in, since a new mode starts over.
+        BricktronicsTimingHistogram _timingUpdate;
+        BricktronicsTimingHistogram _timingInterval;
+        uint32_t _timingLate;
+        uint16_t _timingLateUS;
+        uint32_t _timingLastSample;
+        uint8_t _timingMode;
+        bool _timingHaveSample;
+#endif
+
+        // Backlash compensation variables, see setBacklash(). _backlashTarget
+        // is the last position asked for (before compensation), _backlashOutput
+        // the estimated output position, and _backlashSide which side of the
+        // slop the motor is pushing on (+1 when it's ahead of the output).
+        uint8_t _backlash;
+        int8_t _backlashSide;
+        int32_t _backlashTarget;
+        int32_t _backlashOutput;
+
+        // Load encoder variables, see setLoadEncoder(). _loadPosition is the
+        // load position in motor ticks, built up from the changes in the load
+        // encoder reading (_loadLast) times _loadScale, with 12 fractional bits
+        // (the leftover fraction is in _loadRemainder). _loadOffset is the
+        // filtered difference between the load and motor positions, with 8
+        // fractional bits, and _loadAlpha its filter's gain per millisecond.
+        Encoder *_loadEncoder;
+        int32_t _loadScale;
+        int32_t _loadLast;
+        int32_t _loadRemainder;
+        int32_t _loadPosition;
+        int32_t _loadMotorPosition;
+        int32_t _loadOffset;
+        uint16_t _loadAlpha;
+        unsigned long _loadFilterLast;
+
+        // Input shaper variables, see setInputShaper(). _shaperBuffer holds the
+        // position asked for at each of the last samples, with the newest one
+        // at _shaperHead, and _shaperA1 and _shaperA2 are the sizes of the
+        // delayed steps.
+        uint8_t _shaperType;
+        bool _shaperActive;
+        int32_t _shaperInput;
+        int32_t _shaperBuffer[2 * BRICKTRONICS_MOTOR_SHAPER_TAP_SPACING + 1];
+        uint8_t _shaperHead;
+        double _shaperA1, _shaperA2;
+        uint32_t _shaperSampleUS;
+        unsigned long _shaperLastUS;
+
+        // Learned feed-forward map variables, see setFeedForwardMap()
+        BricktronicsMotorFeedForwardMap *_ffMap;
+        uint16_t _ffMapPeriod;
+        bool _ffMapLearning;
+        int32_t _ffMapLastPosition;
+        unsigned long _ffMapLastTime;
+
+        // Iterative learning control variables, see setIterativeLearning().
+        // _ilcIndex is the sample of the run we're in, and _ilcErrorSum adds
+        // up the absolute position errors over the run.
+        BricktronicsMotorILC *_ilc;
+        uint16_t _ilcSampleTimeMS;
+        double _ilcGain;
+        uint8_t _ilcLead;
+        bool _ilcRunning;
+        uint8_t _ilcIndex;
+        unsigned long _ilcRunStart;
+        uint32_t _ilcErrorSum;
+        uint16_t _ilcRunError;
+
+        // Disturbance observer variables, see setDisturbanceObserver()
+        bool _dobEnabled;
+        uint16_t _dobFilterTimeMS;
+        double _dobDisturbance;
+
+        // Feed-forward drive strength added to the PID outputs, see setFeedForward()
+        int16_t _feedForward;
+
+        // Fitted step response model, see sysidStepResponse()
+        double _modelGain;
+        uint16_t _modelTimeConstantMS;
+        uint16_t _modelDelayMS;
+        bool _modelFeedForward;
+
+        // Relay autotune variables, see autotuneStart()
+        uint8_t _autotuneStatus;
+        uint8_t _autotuneRule;
+        uint8_t _autotuneDrive;
+        uint8_t _autotuneCycles;
+        bool _autotuneDriveUp;
+        int32_t _autotuneSetpoint;
+        int32_t _autotuneMax, _autotuneMin;
+        int32_t _autotuneAmplitudeSum;
+        unsigned long _autotuneLastSwitch;
+        unsigned long _autotuneLastSample;
+        unsigned long _autotuneCycleStart;
+        double _autotuneKu;
+        uint16_t _autotuneTuMS;
+
+        // Tracks the position of the motor
+        Encoder _encoder;
+
+        // Check out the comments above for setAngleOutputMultiplier()
+        int8_t _angleMultiplier;
+
+        // Raw, uncontrolled speed settings
+        // There is no monitoring or control of the speed here,
+        // just set a fixed drive strength between -255 and +255.
+        // Be sure to check out coast(), brake(), and hold().
+        void _rawSetSpeed(int16_t s)
+        {
+            _drive = s;
+            if( _reversed )
+            {
+                s = -s;
+            }
+
+            if( s < 0 )
+            {
+                _digitalWrite(_dirPin, HIGH);
+                analogWrite(_pwmPin, 255 + s);
+            }
+            else
+            {
+                _digitalWrite(_dirPin, LOW);
+                analogWrite(_pwmPin, s);
+            }
+
+            // Enable drivers
+            _digitalWrite(_enPin, HIGH);
+        }
+
+        // Samples the estimator, and checks for a stall every time it has a new
+        // sample. _stallSince is the last time the motor wasn't stalled.
+        void _updateEstimator(void)
+        {
+            if( !_estimator->update(_encoder.read(), micros()) )
+            {
+                return;
+            }
+            unsigned long now = millis();
+            if( abs(_drive) < _stallDrive || abs(_estimator->getSpeed()) >= _stallSpeed )
+            {
+                _stallSince = now;
+            }
+            _stalled = ( now - _stallSince >= _stallTimeMS );
+
+            if( _dobEnabled )
+            {
+                _updateDisturbanceObserver();
+            }
+        }
+
+        // One step of the disturbance observer, run for every new estimator
+        // sample. The load estimate only makes sense while we're driving the
+        // motor with _applyDrive(), so it starts over from zero otherwise.
+        void _updateDisturbanceObserver(void)
+        {
+            if(    _mode != BRICKTRONICS_MOTOR_MODE_PID_POSITION
+                && _mode != BRICKTRONICS_MOTOR_MODE_PID_SPEED
+                && _mode != BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+            {
+                _dobDisturbance = 0;
+                return;
+            }
+            double gain = BRICKTRONICS_MOTOR_MODEL_GAIN;
+            double tau = BRICKTRONICS_MOTOR_MODEL_TIME_CONSTANT_MS / 1000.0;
+            if( _modelGain > 0 )
+            {
+                gain = _modelGain;
+                tau = _modelTimeConstantMS / 1000.0;
+            }
+            double load = _drive - ( _estimator->getSpeed() + tau * _estimator->getAcceleration() ) / gain;
+            double sampleTimeMS = _estimator->getSampleTimeUS() / 1000.0;
+            _dobDisturbance += ( load - _dobDisturbance ) * sampleTimeMS / ( _dobFilterTimeMS + sampleTimeMS );
+            _dobDisturbance = constrain(_dobDisturbance, -255.0, 255.0);
+        }
+
+        // Returns the motor position to aim for so the output ends up at the
+        // position. We'll arrive pushing on the side of the slop facing the
+        // direction we have to move.
+        int32_t _backlashCompensate(int32_t position)
+        {
+            _backlashTarget = position;
+            if( position > _backlashOutput )
+            {
+                _backlashSide = 1;
+            }
+            else if( position < _backlashOutput )
+            {
+                _backlashSide = -1;
+            }
+            return position + _backlashSide * ( _backlash / 2 );
+        }
+
+        // Tracks the output position through the slop in the gears: the output
+        // only moves when the motor pushes it from one side or the other. If the
+        // gears switch sides while holding a position, the motor setpoint is
+        // moved to the other side of the slop.
+        void _updateBacklash(void)
+        {
+            int32_t position = _encoder.read();
+            int16_t half = _backlash / 2;
+            int8_t side = _backlashSide;
+            if( position - _backlashOutput > half )
+            {
+                _backlashOutput = position - half;
+                side = 1;
+            }
+            else if( _backlashOutput - position > half )
+            {
+                _backlashOutput = position + half;
+                side = -1;
+            }
+            if(    side != _backlashSide
+                && ( _mode == BRICKTRONICS_MOTOR_MODE_PID_POSITION || _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE ) )
+            {
+                _pidSetpoint = _backlashTarget + side * half;
+            }
+            _backlashSide = side;
+        }
+
+        // Starts the position control (plain or cascaded) for a motor position,
+        // that is, after any backlash compensation.
+        void _goToMotorPosition(int32_t position)
+        {
+            // Swith our internal PID into position mode
+            if( _cascade )
+            {
+                if( _mode != BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+                {
+                    _startSpeedLoop();
+                    _mode = BRICKTRONICS_MOTOR_MODE_PID_CASCADE;
+                }
+            }
+            else
+            {
+                _mode = BRICKTRONICS_MOTOR_MODE_PID_POSITION;
+            }
+            _pidSetpoint = position;
+        }
+
+        // Takes a snapshot of both encoders, and updates the load position and
+        // the filtered difference to the motor position. The filter moves the
+        // same amount as stepping it once for every millisecond since the last
+        // time would, in one step: what's left of the error after n steps is
+        // (1 - alpha)^n, worked out by squaring. If the difference jumps by
+        // more than 128 ticks, or update() wasn't called for a while, the
+        // filter just starts over from the new difference.
+        void _updateLoadEncoder(void)
+        {
+            int32_t load;
+            Encoder::readPair(_encoder, *_loadEncoder, &_loadMotorPosition, &load);
+            int32_t sum = ( load - _loadLast ) * _loadScale + _loadRemainder;
+            _loadLast = load;
+            _loadPosition += sum >> 12;
+            _loadRemainder = sum & 0xFFF;
+
+            int32_t difference = ( _loadPosition - _loadMotorPosition ) * 256;
+            unsigned long now = millis();
+            unsigned long steps = now - _loadFilterLast;
+            _loadFilterLast = now;
+            int32_t error = difference - _loadOffset;
+            if( steps > 255 || error > 32767 || error < -32767 )
+            {
+                _loadOffset = difference;
+                return;
+            }
+
+            // 1 - alpha, and what's left, with 16 fractional bits
+            uint32_t power = 65536UL - _loadAlpha;
+            uint32_t left = 65536UL;
+            while( steps )
+            {
+                if( steps & 1 )
+                {
+                    left = ( left * power ) >> 16;
+                }
+                steps >>= 1;
+                if( steps )
+                {
+                    power = ( power * power ) >> 16;
+                }
+            }
+            _loadOffset += ( error * (int32_t) ( 65536UL - left ) ) >> 16;
+        }
+
+        // The position the position loop works from: the motor position, or
+        // with a load encoder, the motor position plus the filtered difference.
+        double _feedbackPosition(void)
+        {
+            if( !_loadEncoder )
+            {
+                return _encoder.read();
+            }
+            return _loadMotorPosition + _loadOffset / 256.0;
+        }
+
+        // Starts (or changes the destination of) a shaped move. A new move
+        // starts from the position we were holding, or the current position
+        // if we weren't holding one, with the whole buffer filled with it.
+        void _shaperGoTo(int32_t position)
+        {
+            if( !_shaperActive )
+            {
+                int32_t start = getPosition();
+                if( _mode == BRICKTRONICS_MOTOR_MODE_PID_POSITION || _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+                {
+                    start = _pidSetpoint - _backlashSide * ( _backlash / 2 );
+                }
+                for( uint8_t i = 0; i <= 2 * BRICKTRONICS_MOTOR_SHAPER_TAP_SPACING; i++ )
+                {
+                    _shaperBuffer[i] = start;
+                }
+                _goToMotorPosition(_backlashCompensate(start));
+                _shaperLastUS = micros();
+                _shaperActive = true;
+            }
+            _shaperInput = position;
+        }
+
+        // One sample of the input shaper. The newest position asked for goes
+        // into the buffer, and the position PID gets the sum of it and the
+        // delayed steps. Once the buffer is all the same, the move is done.
+        // If something else took over the motor, we just stop.
+        void _updateShaper(void)
+        {
+            if( _mode != BRICKTRONICS_MOTOR_MODE_PID_POSITION && _mode != BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+            {
+                _shaperActive = false;
+                return;
+            }
+            unsigned long now = micros();
+            if( now - _shaperLastUS < _shaperSampleUS )
+            {
+                return;
+            }
+            _shaperLastUS += _shaperSampleUS;
+            if( now - _shaperLastUS >= _shaperSampleUS )
+            {
+                // We fell behind, don't try to catch up
+                _shaperLastUS = now;
+            }
+
+            const uint8_t size = 2 * BRICKTRONICS_MOTOR_SHAPER_TAP_SPACING + 1;
+            _shaperHead = ( _shaperHead + 1 ) % size;
+            _shaperBuffer[_shaperHead] = _shaperInput;
+            int32_t half = _shaperBuffer[( _shaperHead + size - BRICKTRONICS_MOTOR_SHAPER_TAP_SPACING ) % size];
+            int32_t full = _shaperBuffer[( _shaperHead + 1 ) % size];
+            double shaped = _shaperInput + _shaperA1 * ( half - _shaperInput ) + _shaperA2 * ( full - _shaperInput );
+            _goToMotorPosition(_backlashCompensate(lround(shaped)));
+
+            if( half == _shaperInput && ( full == _shaperInput || _shaperA2 == 0 ) )
+            {
+                _shaperActive = false;
+            }
+        }
+
+        // Resets the speed measurement and the speed PID when entering one of
+        // the modes that use the speed loop, so we don't start from a stale
+        // position sample or a leftover integral term.
+        void _startSpeedLoop(void)
+        {
+            _speedLastPosition = _encoder.read();
+            _speedLastTime = millis();
+            _speedPidInput = 0;
+            _speedPidOutput = 0;
+            _speedPid.SetMode(MANUAL);
+            _speedPid.SetMode(AUTOMATIC);
+        }
+
+        // What the control loop is aiming for and where it is, for the trace
+        // and telemetry: speeds in the speed mode, the drive strength in the
+        // fixed drive mode, and positions otherwise.
+        int32_t _loopSetpoint(void)
+        {
+            switch( _mode )
+            {
+                case BRICKTRONICS_MOTOR_MODE_PID_SPEED:
+                    return _speedPidSetpoint;
+                case BRICKTRONICS_MOTOR_MODE_FIXED_DRIVE:
+                    return (int16_t) _rawSpeed;
+                default:
+                    return _pidSetpoint;
+            }
+        }
+        int32_t _loopInput(void)
+        {
+            switch( _mode )
+            {
+                case BRICKTRONICS_MOTOR_MODE_PID_SPEED:
+                    return _speedPidInput;
+                case BRICKTRONICS_MOTOR_MODE_PID_POSITION:
+                case BRICKTRONICS_MOTOR_MODE_PID_CASCADE:
+                    return _pidInput;
+                default:
+                    return getPosition();
+            }
+        }
+
+        // Adds a control loop sample to the trace, and checks the trigger.
+        // Once the trace is done, this leaves it alone.
+        void _traceRecord(void)
+        {
+            if( _traceTriggered && _traceRemaining == 0 )
+            {
+                return;
+            }
+            BricktronicsMotorTraceSample *sample = &_trace[_traceHead];
+            sample->timeUS = micros();
+            sample->setpoint = _loopSetpoint();
+            sample->input = _loopInput();
+            sample->output = _drive;
+            sample->mode = _mode;
+            sample->flags = 0;
+            if( _stalled )
+            {
+                sample->flags |= BRICKTRONICS_MOTOR_TRACE_STALLED;
+            }
+            if( abs(_drive) >= 255 )
+            {
+                sample->flags |= BRICKTRONICS_MOTOR_TRACE_SATURATED;
+            }
+            if( ++_traceHead >= _traceSize )
+            {
+                _traceHead = 0;
+            }
+            if( _traceCount < _traceSize )
+            {
+                _traceCount++;
+            }
+
+            if( _traceTriggered )
+            {
+                _traceRemaining--;
+            }
+            else if( ( ( _traceConditions & BRICKTRONICS_MOTOR_TRACE_TRIGGER_STALL ) && _stalled ) ||
+                     ( ( _traceConditions & BRICKTRONICS_MOTOR_TRACE_TRIGGER_SATURATED ) && ( sample->flags & BRICKTRONICS_MOTOR_TRACE_SATURATED ) ) ||
+                     ( ( _traceConditions & BRICKTRONICS_MOTOR_TRACE_TRIGGER_ERROR ) && labs(sample->setpoint - sample->input) > _traceErrorThreshold ) )
+            {
+                sample->flags |= BRICKTRONICS_MOTOR_TRACE_TRIGGER;
+                _traceTriggered = true;
+                _traceTriggerUS = sample->timeUS;
+                _traceRemaining = _traceAfter;
+            }
+        }
+
+#if defined(BRICKTRONICS_MOTOR_TIMING)
+        // Adds this update() to the timing histograms. start is when it
+        // started, and samples the control loop sample count back then.
+        void _timingRecord(uint32_t start, uint16_t samples)
+        {
+            uint32_t end = BRICKTRONICS_TIMING_TICKS();
+            BricktronicsTiming::add(&_timingUpdate, BRICKTRONICS_TIMING_TICKS_TO_US(end - start));
+
+            // Coming from another mode (or from coasting), there's no last
+            // sample to measure from
+            if( _mode != _timingMode )
+            {
+                _timingMode = _mode;
+                _timingHaveSample = false;
+            }
+            if( _controlSamples == samples )
+            {
+                return;
+            }
+            if( _timingHaveSample )
+            {
+                // In the cascaded mode, the samples come from the inner speed loop
+                uint16_t sampleTimeMS = _pidSampleTimeMS;
+                if( _mode == BRICKTRONICS_MOTOR_MODE_PID_SPEED || _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+                {
+                    sampleTimeMS = _speedSampleTimeMS;
+                }
+                int32_t late = (int32_t) BRICKTRONICS_TIMING_TICKS_TO_US(start - _timingLastSample) - sampleTimeMS * 1000L;
+                BricktronicsTiming::add(&_timingInterval, late);
+                if( late > (int32_t) _timingLateUS )
+                {
+                    _timingLate++;
+                }
+            }
+            _timingLastSample = start;
+            _timingHaveSample = true;
+        }
+#endif
+
+        // Measures the speed since the last speed loop update and runs the speed PID.
+        // If the PID decides it isn't time yet, we keep the old position sample
+        // and try again next time, so the measurement always spans a whole sample.
+        // With an estimator attached, we use its speed instead.
+        void _updateSpeedLoop(void)
+        {
+            unsigned long now = millis();
+            unsigned long elapsed = now - _speedLastTime;
+            if( elapsed >= _speedSampleTimeMS )
+            {
+                int32_t position = _encoder.read();
+                if( _estimator )
+                {
+                    _speedPidInput = _estimator->getSpeed();
+                }
+                else
+                {
+                    _speedPidInput = (double) ( position - _speedLastPosition ) * 1000 / elapsed;
+                }
+                if( _speedPid.Compute() )
+                {
+                    _controlSamples++;
+                    _speedLastPosition = position;
+                    _speedLastTime = now;
+                    if( _ffMapLearning )
+                    {
+                        _ffMapLearn(_speedPid.GetITerm());
+                    }
+                    _applyDrive(_speedPidOutput + _modelSpeedFeedForward());
+                }
+            }
+        }
+
+        // One step of the relay autotune. The relay flips whenever the motor
+        // crosses the hysteresis band around the setpoint, and each time it
+        // flips back to driving up we have seen one full oscillation cycle.
+        // The relay only looks at the motor as often as the position PID will,
+        // so the delay from sampling is part of the measured ultimate gain and
+        // period, and the tunings we pick account for it.
+        void _updateAutotune(void)
+        {
+            unsigned long now = millis();
+            if( now - _autotuneLastSample < _pidSampleTimeMS )
+            {
+                return;
+            }
+            _autotuneLastSample = now;
+            int32_t position = _encoder.read();
+
+            if( position > _autotuneMax )
+            {
+                _autotuneMax = position;
+            }
+            if( position < _autotuneMin )
+            {
+                _autotuneMin = position;
+            }
+
+            if( _autotuneDriveUp && position > _autotuneSetpoint + BRICKTRONICS_MOTOR_AUTOTUNE_HYSTERESIS )
+            {
+                _autotuneDriveUp = false;
+                _autotuneLastSwitch = now;
+                _rawSetSpeed(-_autotuneDrive);
+            }
+            else if( !_autotuneDriveUp && position < _autotuneSetpoint - BRICKTRONICS_MOTOR_AUTOTUNE_HYSTERESIS )
+            {
+                _autotuneDriveUp = true;
+                _autotuneLastSwitch = now;
+                _rawSetSpeed(_autotuneDrive);
+
+                // A full cycle ends here, but the peaks of the first cycles
+                // are still growing, so we skip those.
+                if( _autotuneCycles == BRICKTRONICS_MOTOR_AUTOTUNE_SETTLE_CYCLES )
+                {
+                    _autotuneCycleStart = now;
+                }
+                else if( _autotuneCycles > BRICKTRONICS_MOTOR_AUTOTUNE_SETTLE_CYCLES )
+                {
+                    _autotuneAmplitudeSum += _autotuneMax - _autotuneMin;
+                }
+                _autotuneCycles++;
+                _autotuneMax = position;
+                _autotuneMin = position;
+
+                if( _autotuneCycles > BRICKTRONICS_MOTOR_AUTOTUNE_SETTLE_CYCLES + BRICKTRONICS_MOTOR_AUTOTUNE_MEASURE_CYCLES )
+                {
+                    _finishAutotune(now);
+                    return;
+                }
+            }
+
+            if( now - _autotuneLastSwitch > BRICKTRONICS_MOTOR_AUTOTUNE_TIMEOUT_MS )
+            {
+                _autotuneStatus = BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_FAILED;
+                _goToMotorPosition(_autotuneSetpoint);
+            }
+        }
+
+        // Computes the ultimate gain and period from the measured cycles,
+        // applies the selected tuning rule and holds the starting position.
+        // The amplitude is corrected for the relay hysteresis, so the relay
+        // describing function is Ku = 4 * d / (pi * sqrt(a^2 - h^2)).
+        void _finishAutotune(unsigned long now)
+        {
+            double amplitude = (double) _autotuneAmplitudeSum / ( 2 * BRICKTRONICS_MOTOR_AUTOTUNE_MEASURE_CYCLES );
+            double hysteresis = BRICKTRONICS_MOTOR_AUTOTUNE_HYSTERESIS;
+            if( amplitude <= hysteresis )
+            {
+                _autotuneStatus = BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_FAILED;
+            }
+            else
+            {
+                _autotuneKu = 4.0 * _autotuneDrive / ( M_PI * sqrt( amplitude * amplitude - hysteresis * hysteresis ) );
+                _autotuneTuMS = ( now - _autotuneCycleStart ) / BRICKTRONICS_MOTOR_AUTOTUNE_MEASURE_CYCLES;
+                autotuneApplyRule(_autotuneRule);
+                _autotuneStatus = BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_DONE;
+            }
+            _goToMotorPosition(_autotuneSetpoint);
+        }
+
+        // Finds the breakpoint segment containing value, and returns the 8-bit
+        // interpolation weight (0 - 256) of the upper end of that segment.
+        static uint16_t _gainScheduleLookup(const uint16_t *breakpoints, const uint16_t *scale, uint8_t points, uint32_t value, uint8_t *index)
+        {
+            uint8_t i = 0;
+            while( i + 2 < points && value >= breakpoints[i + 1] )
+            {
+                i++;
+            }
+            *index = i;
+            if( points < 2 || value <= breakpoints[i] )
+            {
+                return 0;
+            }
+            if( value >= breakpoints[i + 1] )
+            {
+                return 256;
+            }
+            return ( (uint32_t) ( value - breakpoints[i] ) * scale[i] ) >> 8;
+        }
+
+        // Checks the number of breakpoints on one axis of a gain schedule, and
+        // that they go up (the interpolation divides by the gaps between them).
+        static bool _gainScheduleAxisOK(const uint16_t *breakpoints, uint8_t points)
+        {
+            if( points < 1 || points > BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS )
+            {
+                return false;
+            }
+            for( uint8_t i = 0; i + 1 < points; i++ )
+            {
+                if( breakpoints[i + 1] <= breakpoints[i] )
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Bilinear interpolation between the four table entries around the
+        // current error and speed, with the 8-bit weights from above.
+        static double _gainScheduleBlend(const double table[][BRICKTRONICS_MOTOR_GAIN_SCHEDULE_MAX_POINTS], uint8_t e, uint8_t v, uint8_t e1, uint8_t v1, uint16_t we, uint16_t wv)
+        {
+            double low = table[e][v] * 256 + ( table[e][v1] - table[e][v] ) * wv;
+            double high = table[e1][v] * 256 + ( table[e1][v1] - table[e1][v] ) * wv;
+            return ( low * 256 + ( high - low ) * we ) * ( 1.0 / 65536 );
+        }
+
+        // Interpolates new position PID tunings from the gain schedule, using
+        // the latest error and the speed since the last PID update.
+        void _updateGainSchedule(void)
+        {
+            int32_t input = _pidInput;
+            uint32_t error = abs(_pidSetpoint - input);
+            uint32_t speed = _estimator ? abs(_estimator->getSpeed()) : (uint32_t) abs(input - _gainScheduleLastInput) * 1000 / _pidSampleTimeMS;
+            _gainScheduleLastInput = input;
+
+            uint8_t e, v;
+            uint16_t we = _gainScheduleLookup(_gainSchedule->errorBreakpoints, _gainSchedule->errorScale, _gainSchedule->errorPoints, error, &e);
+            uint16_t wv = _gainScheduleLookup(_gainSchedule->speedBreakpoints, _gainSchedule->speedScale, _gainSchedule->speedPoints, speed, &v);
+            uint8_t e1 = ( _gainSchedule->errorPoints > 1 ) ? e + 1 : e;
+            uint8_t v1 = ( _gainSchedule->speedPoints > 1 ) ? v + 1 : v;
+
+            _pid.ScheduleTunings(_gainScheduleBlend(_gainSchedule->Kp, e, v, e1, v1, we, wv),
+                                 _gainScheduleBlend(_gainSchedule->Ki, e, v, e1, v1, we, wv),
+                                 _gainScheduleBlend(_gainSchedule->Kd, e, v, e1, v1, we, wv));
+        }
+
+        // Adds the feed-forward drive strength (and the load estimate from the
+        // disturbance observer, the learned map, and in the position and
+        // cascaded modes the iterative learning correction) to a PID output,
+        // keeps the result within the allowed range, and sends it to the motor.
+        void _applyDrive(double output)
+        {
+            output += _feedForward + _dobDisturbance;
+            if( _ffMap )
+            {
+                output += _ffMapLookup() / 16.0;
+            }
+            if( _ilcRunning && ( _mode == BRICKTRONICS_MOTOR_MODE_PID_POSITION || _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE ) )
+            {
+                output += _ilc->correction[_ilcIndex] / 16.0;
+            }
+            if( output > 255 )
+            {
+                output = 255;
+            }
+            else if( output < -255 )
+            {
+                output = -255;
+            }
+            _rawSetSpeed(output);
+        }
+
+        // At the end of each sample of a run, learns from the position error.
+        // The correction that was applied _ilcLead samples ago gets the blame
+        // (or the credit) for it. Nothing is learned outside the position and
+        // cascaded modes, but the run keeps going so it stays in step.
+        void _updateILC(void)
+        {
+            if( millis() - _ilcRunStart < (uint32_t) ( _ilcIndex + 1 ) * _ilcSampleTimeMS )
+            {
+                return;
+            }
+            if( _mode == BRICKTRONICS_MOTOR_MODE_PID_POSITION || _mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+            {
+                // The same error the position loop sees, from the load
+                // encoder when there is one
+                int32_t error = _pidSetpoint - _feedbackPosition();
+                _ilcErrorSum += abs(error);
+                if( _ilcIndex + 1 >= _ilcLead )
+                {
+                    _ilcLearn(&_ilc->correction[_ilcIndex + 1 - _ilcLead], error);
+                }
+            }
+            _ilcIndex++;
+            if( _ilcIndex >= BRICKTRONICS_MOTOR_ILC_SAMPLES )
+            {
+                _ilcEndRun();
+            }
+        }
+
+        // Adds the error (times the gain) to one correction, keeping it within
+        // the drive strength range.
+        void _ilcLearn(int16_t *correction, int32_t error)
+        {
+            int32_t c = *correction + (int32_t) ( error * _ilcGain * 16 );
+            if( c > 255 * 16 )
+            {
+                c = 255 * 16;
+            }
+            else if( c < -255 * 16 )
+            {
+                c = -255 * 16;
+            }
+            *correction = c;
+        }
+
+        void _ilcEndRun(void)
+        {
+            _ilcRunning = false;
+            if( _ilcIndex > 0 )
+            {
+                _ilcRunError = _ilcErrorSum / _ilcIndex;
+            }
+        }
+
+        // Where a position is in the map, in 256ths of a bin from the start of bin 0.
+        uint16_t _ffMapPhase(int32_t position)
+        {
+            int32_t phase = position % _ffMapPeriod;
+            if( phase < 0 )
+            {
+                phase += _ffMapPeriod;
+            }
+            return ( (uint32_t) phase * BRICKTRONICS_MOTOR_FF_MAP_BINS * 256 ) / _ffMapPeriod;
+        }
+
+        // The learned drive strength (in 16ths) at the current position,
+        // interpolated between the two closest bins.
+        int16_t _ffMapLookup(void)
+        {
+            uint16_t phase = _ffMapPhase(_encoder.read());
+            uint8_t bin = phase >> 8;
+            uint8_t next = ( bin + 1 ) % BRICKTRONICS_MOTOR_FF_MAP_BINS;
+            int16_t a = _ffMap->drive[bin];
+            int16_t b = _ffMap->drive[next];
+            return a + (int16_t) ( ( (int32_t) ( b - a ) * ( phase & 0xFF ) ) >> 8 );
+        }
+
+        // Moves part of the integral term into the map. As the map takes over,
+        // the integral term has less and less left to do, so the learning
+        // slows down and stops once the map is right.
+        // The integral term only catches up with a load about one time constant
+        // of the motor after the motor got there, so it goes into the bin where
+        // the motor was back then. Learning it where the motor is now would
+        // shift the map a little further ahead on every pass, until it doesn't
+        // line up with the loads at all.
+        void _ffMapLearn(double iTerm)
+        {
+            int32_t position = _encoder.read();
+            unsigned long now = millis();
+            unsigned long elapsed = now - _ffMapLastTime;
+            int32_t moved = position - _ffMapLastPosition;
+            _ffMapLastPosition = position;
+            _ffMapLastTime = now;
+            if( !_ffMap || elapsed == 0 || elapsed > 2 * _pidSampleTimeMS )
+            {
+                // We haven't been learning, so we don't know how fast the motor is going
+                return;
+            }
+
+            uint16_t tauMS = BRICKTRONICS_MOTOR_MODEL_TIME_CONSTANT_MS;
+            if( _modelGain > 0 )
+            {
+                tauMS = _modelTimeConstantMS;
+            }
+            position -= moved * (int32_t) tauMS / (int32_t) elapsed;
+            uint8_t bin = ( ( _ffMapPhase(position) + 128 ) >> 8 ) % BRICKTRONICS_MOTOR_FF_MAP_BINS;
+            int32_t drive = _ffMap->drive[bin] + (int32_t) ( iTerm * BRICKTRONICS_MOTOR_FF_MAP_LEARN_RATE / 16 );
+            if( drive > 255 * 16 )
+            {
+                drive = 255 * 16;
+            }
+            else if( drive < -255 * 16 )
+            {
+                drive = -255 * 16;
+            }
+            _ffMap->drive[bin] = drive;
+        }
+
+#if defined(__AVR__)
+        // Checksum of a saved map (everything but the checksum byte itself).
+        // It starts from a non-zero value, so blank (all 0xFF) or cleared
+        // EEPROM isn't mistaken for a saved map.
+        uint8_t _ffMapChecksum(uint16_t address)
+        {
+            uint8_t sum = 0xA5;
+            for( uint8_t i = 0; i < BRICKTRONICS_MOTOR_FF_MAP_EEPROM_SIZE - 1; i++ )
+            {
+                sum = ( ( sum << 1 ) | ( sum >> 7 ) ) ^ eeprom_read_byte((uint8_t *) address + i);
+            }
+            return sum;
+        }
+#endif
+
+        // The drive strength the fitted model says we need for the speed loop setpoint.
+        double _modelSpeedFeedForward(void)
+        {
+            if( !_modelFeedForward || _modelGain <= 0 )
+            {
+                return 0;
+            }
+            return _speedPidSetpoint / _modelGain;
+        }
+
+        // Fits a first-order-plus-dead-time speed model to the recorded step
+        // response, using the area method so we never have to differentiate the
+        // (coarse) encoder positions. The speed settles to vss = K * drive, and
+        // the position then follows vss * (t - theta - tau), so the steady-state
+        // slope gives the gain and the intercept gives theta + tau. The position
+        // reached at that time is vss * tau / e, which splits it into the two parts.
+        bool _fitStepResponse(const int16_t *samples, uint8_t drive, unsigned long sampleTimeUS)
+        {
+            const uint8_t last = BRICKTRONICS_MOTOR_SYSID_SAMPLES - 1;
+            const uint8_t quarter = BRICKTRONICS_MOTOR_SYSID_SAMPLES / 4;
+
+            // Steady-state speed from the slope over the last quarter of the samples
+            double sampleTime = sampleTimeUS / 1000000.0;
+            double vss = (double) ( samples[last] - samples[last - quarter] ) / ( quarter * sampleTime );
+            if( drive == 0 || vss * sampleTime < 1 )
+            {
+                return false;
+            }
+
+            // Intercept of the steady-state line with the time axis, which
+            // is theta + tau (sample i was taken at time (i + 1) * sampleTime)
+            double endTime = ( last + 1 ) * sampleTime;
+            double lag = endTime - samples[last] / vss;
+            if( lag <= 0 || lag >= endTime )
+            {
+                return false;
+            }
+
+            // Position at time lag, interpolated between the samples around it
+            double index = lag / sampleTime - 1;
+            double positionAtLag = 0;
+            if( index >= 0 )
+            {
+                uint8_t i = index;
+                positionAtLag = samples[i] + ( index - i ) * ( samples[i + 1] - samples[i] );
+            }
+            else
+            {
+                positionAtLag = ( index + 1 ) * samples[0];
+            }
+
+            double tau = M_E * positionAtLag / vss;
+            if( tau > lag )
+            {
+                tau = lag;
+            }
+            _modelGain = vss / drive;
+            _modelTimeConstantMS = tau * 1000 + 0.5;
+            _modelDelayMS = ( lag - tau ) * 1000 + 0.5;
+            _minTimeBuildCurve(_modelGain, _modelTimeConstantMS, _modelDelayMS);
+            return true;
+        }
+
+        // Fills in the minimum-time switching curve for a motor with the given
+        // speed model. Braking at full reverse drive from speed v, the speed
+        // heads towards -vmax with time constant tau, and the distance covered
+        // until it stops is tau * (v - vmax * ln(1 + v / vmax)). On top of that
+        // comes the distance covered during the dead time.
+        void _minTimeBuildCurve(double gain, uint16_t timeConstantMS, uint16_t delayMS)
+        {
+            double vmax = gain * 255;
+            double tau = timeConstantMS / 1000.0;
+            double delay = delayMS / 1000.0;
+            _minTimeCurveStep = vmax / ( BRICKTRONICS_MOTOR_MIN_TIME_CURVE_POINTS - 1 ) + 1;
+            for( uint8_t i = 0; i < BRICKTRONICS_MOTOR_MIN_TIME_CURVE_POINTS; i++ )
+            {
+                double v = (double) i * _minTimeCurveStep;
+                double distance = tau * ( v - vmax * log(1 + v / vmax) ) + v * delay;
+                _minTimeCurve[i] = min(distance * 8, 65535.0);
+            }
+        }
+
+        // Looks up the braking distance (in eighths of a tick) for a speed,
+        // interpolating between the points of the switching curve.
+        uint16_t _minTimeBrakingDistance(uint16_t speed)
+        {
+            // Past the last point (the quotient can be well over 255 when
+            // the points are close together)
+            uint16_t point = speed / _minTimeCurveStep;
+            if( point >= BRICKTRONICS_MOTOR_MIN_TIME_CURVE_POINTS - 1 )
+            {
+                return _minTimeCurve[BRICKTRONICS_MOTOR_MIN_TIME_CURVE_POINTS - 1];
+            }
+            uint8_t i = point;
+            uint16_t fraction = speed - i * _minTimeCurveStep;
+            return _minTimeCurve[i] + (uint32_t) ( _minTimeCurve[i + 1] - _minTimeCurve[i] ) * fraction / _minTimeCurveStep;
+        }
+
+        // One step of a minimum-time move. The speed is measured every speed
+        // sample time (or comes from the estimator), but the switching curve is
+        // checked on every call.
+        void _updateMinTime(void)
+        {
+            int32_t position = _encoder.read();
+            unsigned long now = millis();
+            if( _estimator )
+            {
+                _speedPidInput = _estimator->getSpeed();
+            }
+            else if( now - _speedLastTime >= _speedSampleTimeMS )
+            {
+                _speedPidInput = (double) ( position - _speedLastPosition ) * 1000 / ( now - _speedLastTime );
+                _speedLastPosition = position;
+                _speedLastTime = now;
+            }
+
+            int32_t error = (int32_t) _pidSetpoint - position;
+            int8_t direction = ( error < 0 ) ? -1 : 1;
+            int32_t distance = abs(error);
+            // Speed towards the destination, negative if we're moving away
+            int16_t speed = _speedPidInput * direction;
+
+            // While braking, the motor has stopped as soon as it starts to
+            // come back, which we see a lot sooner in the position than in
+            // the measured speed. If it stopped too far from the destination
+            // (the load is heavier than the model), we go again from there.
+            if( _minTimeBraking )
+            {
+                if( distance < _minTimeClosest )
+                {
+                    _minTimeClosest = distance;
+                }
+                if( speed <= 0 || distance > _minTimeClosest )
+                {
+                    _minTimeBraking = false;
+                    _speedLastPosition = position;
+                    _speedLastTime = now;
+                    _speedPidInput = 0;
+                    speed = 0;
+                }
+            }
+
+            if( !_minTimeBraking && distance <= _minTimeHandoff )
+            {
+                // Hand off to the PID, starting it fresh (no integral term)
+                _pidInput = position;
+                _pidOutput = 0;
+                _pid.SetMode(MANUAL);
+                _pid.SetMode(AUTOMATIC);
+                // The position loop takes over from the next update()
+                _goToMotorPosition(_pidSetpoint);
+                return;
+            }
+
+            // Once we start braking we keep at it until the motor stops, since
+            // the measured speed lags behind and would have us speed up again.
+            if( !_minTimeBraking && speed > 0 && (uint32_t) distance * 8 <= _minTimeBrakingDistance(speed) )
+            {
+                _minTimeBraking = true;
+                _minTimeClosest = distance;
+            }
+            _rawSetSpeed(_minTimeBraking ? -255 * direction : 255 * direction);
+        }
+
+        // If you reverse the speed/direction pins, the motor runs backwards.
+        // Use this value to switch how your speed settings are applied.
+        // See _rawSetSpeed above.
+        // The Bricktronics Shield has the speed/direction signals reversed
+        // from the canonical naming used on the Bricktronics Motor Driver and
         // Bricktronics Megashield, so the Bricktronics Shield constructor
         // sets this to true.
         bool _reversed;
@@ -523,5 +3100,8 @@ class BricktronicsMotor
         int (*_digitalRead)(uint8_t);
 };
 
+// The usual motor, with PID position control
+typedef BricktronicsControlledMotor<BricktronicsPIDController> BricktronicsMotor;
+
 #endif // #ifdef BRICKTRONICSMOTOR_H
 
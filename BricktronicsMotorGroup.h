@@ -0,0 +1,877 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSMOTORGROUP_H
+#define BRICKTRONICSMOTORGROUP_H
+
+// Coordinated moves for a pair of motors driving the X and Y axes of
+// something like a plotter.
+//
+// The group moves a reference point along straight lines and circular arcs
+// at a constant speed, and sends each motor's position PID its part of it.
+// On their own, two PIDs that lag behind by different amounts (different
+// loads, different friction) cut the corners of the path, and the error
+// across the path (the contour error) is what ruins a drawing. So the group
+// also measures the contour error from a snapshot of both encoders, and
+// feeds it back through a PI controller of its own: each axis setpoint is
+// pushed back towards the path by its share of the correction, along the
+// direction across the path. This is cross-coupled control: each axis
+// corrects for the other axis' error too.
+//
+// The two motors can also be the shoulder and elbow of a two-link arm (see
+// BricktronicsKinematics.h). Then the path is followed by the end of the
+// arm, and the group converts between the path and the motor positions with
+// the arm's kinematics.
+//
+// Moves can also be queued up (see setQueue()), to run one after another
+// without stopping. With an acceleration limit, the group ramps the speed up
+// and down, and plans ahead over the queue like a CNC controller: instead of
+// slowing to a stop at the end of every move, it only slows down as much as
+// the corner into the next move needs, and only stops at the end of the
+// queue. Each move's starting speed is worked out backwards from the end of
+// the queue (so every move can still slow down in time for the ones after
+// it), then forwards from the current move (so it can get up to that speed).
+// How fast a corner can be taken comes from "junction deviation": the speed
+// that, going around a small arc no more than the junction deviation away
+// from the corner, needs just the acceleration limit.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsMotor.h"
+#include "utility/BricktronicsKinematics.h"
+
+// How often the group moves the reference point and checks the contour error
+#define BRICKTRONICS_MOTOR_GROUP_SAMPLE_TIME_MS             10
+
+// Default contour error gains: the proportional gain (ticks of correction
+// per tick of contour error) and the integral gain (per second)
+#define BRICKTRONICS_MOTOR_GROUP_CONTOUR_KP                 1.0
+#define BRICKTRONICS_MOTOR_GROUP_CONTOUR_KI                 4.0
+
+// The integral of the contour error is limited to this many tick-seconds
+#define BRICKTRONICS_MOTOR_GROUP_CONTOUR_MAX_INTEGRAL       5.0
+
+// How far (ticks) from a corner between queued moves the path may round it
+#define BRICKTRONICS_MOTOR_GROUP_JUNCTION_DEVIATION         1.0
+
+// What the group is doing
+#define BRICKTRONICS_MOTOR_GROUP_IDLE                       0
+#define BRICKTRONICS_MOTOR_GROUP_LINE                       1
+#define BRICKTRONICS_MOTOR_GROUP_ARC                        2
+
+// A queued move, see setQueue(). Make an array of these for the group to
+// keep the queue in. The group fills them in, leave them alone.
+typedef struct BricktronicsMotorGroupMove
+{
+   uint8_t type;
+   // The end of a line, or the center of an arc
+   int32_t x, y;
+   int16_t degrees;
+   uint16_t speed;
+   double length;
+   // The fastest the move could start, from the corner with the move before
+   double maxEntrySpeed;
+   // How fast it will start, as planned
+   double entrySpeed;
+} BricktronicsMotorGroupMove;
+
+template <class Controller>
+class BricktronicsControlledMotorGroup
+{
+    public:
+        // The motors aren't copied, so they need to stay around (global
+        // variables are easiest).
+        BricktronicsControlledMotorGroup(BricktronicsControlledMotor<Controller> &x, BricktronicsControlledMotor<Controller> &y):
+            _x(x),
+            _y(y),
+            _segment(BRICKTRONICS_MOTOR_GROUP_IDLE),
+            _arm(NULL),
+            _queue(NULL),
+            _queueSize(0),
+            _queueFirst(0),
+            _queueCount(0),
+            _acceleration(0),
+            _junctionDeviation(BRICKTRONICS_MOTOR_GROUP_JUNCTION_DEVIATION),
+            _crossCoupling(true),
+            _contourKp(BRICKTRONICS_MOTOR_GROUP_CONTOUR_KP),
+            _contourKi(BRICKTRONICS_MOTOR_GROUP_CONTOUR_KI),
+            _contourIntegral(0),
+            _contourError(0),
+            _maxContourError(0),
+            _sampleTimeMS(BRICKTRONICS_MOTOR_GROUP_SAMPLE_TIME_MS),
+            _length(0),
+            _distance(0)
+        {
+        }
+
+        // Call this (instead of each motor's update()) as often as you can.
+        // It updates both motors, and moves the reference point along the
+        // path every _sampleTimeMS.
+        void update(void)
+        {
+            _x.update();
+            _y.update();
+
+            unsigned long now = millis();
+            if( _segment == BRICKTRONICS_MOTOR_GROUP_IDLE || now - _lastSample < _sampleTimeMS )
+            {
+                return;
+            }
+            _lastSample = now;
+            _updatePath(now);
+        }
+
+        // Moves in a straight line from the end of the last move (or where
+        // the motors are, if they weren't moving together) to (x, y), at speed
+        // ticks per second along the line. Returns false, and doesn't move,
+        // if an arm is attached and can't reach (x, y). This and moveArc()
+        // empty the queue, if there is one, and start right away.
+        bool moveLine(int32_t x, int32_t y, uint16_t speed)
+        {
+            if( !_setEnd(x, y) )
+            {
+                return false;
+            }
+            _startSegment();
+            _beginLine(x, y, speed);
+            _setProfile(0, 0);
+            return true;
+        }
+
+        // Moves along a circular arc around (centerX, centerY), from the end
+        // of the last move, turning through degrees (positive is
+        // counter-clockwise, from +X towards +Y), at speed ticks per second
+        // along the arc. 360 draws a full circle. Returns false, and doesn't
+        // move, if an arm is attached and can't reach the end of the arc.
+        bool moveArc(int32_t centerX, int32_t centerY, int16_t degrees, uint16_t speed)
+        {
+            int32_t startX, startY, endX, endY;
+            double radius, startAngle, sweep;
+            _currentPoint(&startX, &startY);
+            _arcShape(startX, startY, centerX, centerY, degrees, &radius, &startAngle, &sweep, &endX, &endY);
+            if( !_setEnd(endX, endY) )
+            {
+                return false;
+            }
+            _startSegment();
+            _beginArc(centerX, centerY, degrees, speed);
+            _setProfile(0, 0);
+            return true;
+        }
+
+        // True once the reference point has reached the end of the move and
+        // both motors have settled there.
+        bool settled(void)
+        {
+            return    _segment == BRICKTRONICS_MOTOR_GROUP_IDLE
+                   || (    _queueCount == 0
+                        && _distance >= _length
+                        && _x.settledAtPosition(_endPositionX)
+                        && _y.settledAtPosition(_endPositionY) );
+        }
+
+        // Calls update() until the move has settled, or timeoutMS have passed.
+        bool waitForArrivalOrTimeout(uint32_t timeoutMS)
+        {
+            uint32_t startTime = millis();
+            while( !settled() )
+            {
+                if( millis() - startTime > timeoutMS )
+                {
+                    return false;
+                }
+                update();
+            }
+            return true;
+        }
+
+        // Stops the coordinated move, empties the queue, and holds both
+        // motors where they are.
+        void stop(void)
+        {
+            _segment = BRICKTRONICS_MOTOR_GROUP_IDLE;
+            _queueCount = 0;
+            _x.hold();
+            _y.hold();
+        }
+
+        // Queued move functions
+        // Start keeping a queue of moves in an array of size moves. The
+        // array is not copied, so it needs to stay around (a global variable
+        // is easiest). Pass NULL to stop using it. This stops any move in
+        // progress.
+        void setQueue(BricktronicsMotorGroupMove *queue, uint8_t size)
+        {
+            stop();
+            _queue = queue;
+            _queueSize = queue ? size : 0;
+            _queueFirst = 0;
+        }
+
+        // Queue up a line or an arc, like moveLine() and moveArc(), to start
+        // at the end of the last move in the queue. If nothing is moving, it
+        // starts right away. Returns false, and doesn't queue it, if the
+        // queue is full (or not set up), or an arm is attached and can't
+        // reach the end of the move.
+        bool addLine(int32_t x, int32_t y, uint16_t speed)
+        {
+            if( _queueCount >= _queueSize || !_canReach(x, y) )
+            {
+                return false;
+            }
+            int32_t startX, startY;
+            _queueEnd(&startX, &startY);
+            double dx = x - startX;
+            double dy = y - startY;
+            double length = sqrt(dx * dx + dy * dy);
+            double ux = 1, uy = 0;
+            if( length >= 1 )
+            {
+                ux = dx / length;
+                uy = dy / length;
+            }
+            BricktronicsMotorGroupMove &move = _queuedMove(_queueCount);
+            move.type = BRICKTRONICS_MOTOR_GROUP_LINE;
+            move.x = x;
+            move.y = y;
+            move.speed = speed;
+            move.length = length;
+            _addMove(move, ux, uy, ux, uy, _speedLimit(speed, 0), x, y);
+            return true;
+        }
+        bool addArc(int32_t centerX, int32_t centerY, int16_t degrees, uint16_t speed)
+        {
+            int32_t startX, startY, endX, endY;
+            double radius, startAngle, sweep;
+            _queueEnd(&startX, &startY);
+            _arcShape(startX, startY, centerX, centerY, degrees, &radius, &startAngle, &sweep, &endX, &endY);
+            if( _queueCount >= _queueSize || !_canReach(endX, endY) )
+            {
+                return false;
+            }
+            BricktronicsMotorGroupMove &move = _queuedMove(_queueCount);
+            move.type = BRICKTRONICS_MOTOR_GROUP_ARC;
+            move.x = centerX;
+            move.y = centerY;
+            move.degrees = degrees;
+            move.speed = speed;
+            move.length = radius < 1 ? 0 : fabs(sweep) * radius;
+            // The direction of travel is at right angles to the radius,
+            // turning the way the arc goes
+            double turn = sweep < 0 ? -1 : 1;
+            double endAngle = startAngle + sweep;
+            _addMove(move, -turn * sin(startAngle), turn * cos(startAngle), -turn * sin(endAngle), turn * cos(endAngle), _speedLimit(speed, radius), endX, endY);
+            return true;
+        }
+
+        // How many moves are waiting in the queue, after the current one.
+        uint8_t getQueued(void)
+        {
+            return _queueCount;
+        }
+
+        // Set the acceleration limit (ticks per second per second) along the
+        // path. Moves ramp their speed up and down, and queued moves are
+        // planned to only slow down for corners. 0, the default, is no limit:
+        // every move runs at its own speed from start to end, and queued
+        // moves change speed and direction in one go.
+        void setAcceleration(uint16_t acceleration)
+        {
+            _acceleration = acceleration;
+        }
+        uint16_t getAcceleration(void)
+        {
+            return _acceleration;
+        }
+
+        // Set how far (ticks) from a corner between queued moves the path
+        // may round it, which sets how fast corners are taken. 0 stops at
+        // every corner. Defaults to 1.
+        void setJunctionDeviation(double ticks)
+        {
+            _junctionDeviation = ticks;
+        }
+        double getJunctionDeviation(void)
+        {
+            return _junctionDeviation;
+        }
+
+        // Cross-coupled contour control functions
+        // Turn the contour error feedback on or off (it's on by default).
+        // With it off, each axis just follows its part of the reference point.
+        void setCrossCoupling(bool enable)
+        {
+            _crossCoupling = enable;
+        }
+        bool getCrossCoupling(void)
+        {
+            return _crossCoupling;
+        }
+
+        // The PI gains on the contour error: Kp is ticks of correction per
+        // tick of contour error, and Ki the same per second. Too much Kp makes
+        // the motors buzz across the path.
+        void setContourTunings(double Kp, double Ki)
+        {
+            if( Kp >= 0 && Ki >= 0 )
+            {
+                _contourKp = Kp;
+                _contourKi = Ki;
+            }
+        }
+        double getContourKp(void)
+        {
+            return _contourKp;
+        }
+        double getContourKi(void)
+        {
+            return _contourKi;
+        }
+
+        // The latest contour error (ticks), positive to the left of the
+        // direction of travel on a line, and outside the circle on an arc.
+        double getContourError(void)
+        {
+            return _contourError;
+        }
+
+        // The largest contour error (ticks) seen since the start of the last
+        // move, useful to compare tunings.
+        double getMaxContourError(void)
+        {
+            return _maxContourError;
+        }
+
+        // Two-link arm functions
+        // Start using the kinematics of a two-link arm, with the first motor
+        // as the shoulder and the second as the elbow. Paths are then in the
+        // arm's length units, and followed by the end of the arm. The arm is
+        // not copied, so it needs to stay around (a global variable is
+        // easiest). Pass NULL to stop using it.
+        void setArm(BricktronicsTwoLinkArm *arm)
+        {
+            stop();
+            _arm = arm;
+        }
+        BricktronicsTwoLinkArm *getArm(void)
+        {
+            return _arm;
+        }
+
+        // Set how often (ms) the reference point moves and the contour error
+        // is checked. Defaults to 10.
+        void setSampleTimeMS(uint16_t sampleTimeMS)
+        {
+            if( sampleTimeMS > 0 )
+            {
+                _sampleTimeMS = sampleTimeMS;
+            }
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        BricktronicsControlledMotor<Controller> &_x;
+        BricktronicsControlledMotor<Controller> &_y;
+        BricktronicsTwoLinkArm *_arm;
+
+        // The moves waiting after the current one, in a circular buffer
+        BricktronicsMotorGroupMove *_queue;
+        uint8_t _queueSize, _queueFirst, _queueCount;
+        double _acceleration;
+        double _junctionDeviation;
+        // The end of the last move (queued, or the current one), the
+        // direction it ends going in, and its top speed, for working out
+        // the corner into the next one
+        int32_t _lastX, _lastY;
+        double _lastDirectionX, _lastDirectionY;
+        double _lastSpeed;
+
+        uint8_t _segment;
+        bool _crossCoupling;
+        double _contourKp, _contourKi;
+        double _contourIntegral;
+        double _contourError;
+        double _maxContourError;
+        uint16_t _sampleTimeMS;
+        unsigned long _lastSample;
+
+        // The current move: it starts at (_startX, _startY) and ends at
+        // (_endX, _endY), _length ticks later along the path. _distance is
+        // how far along the reference point is.
+        int32_t _startX, _startY;
+        int32_t _endX, _endY;
+        // The motor positions at the end of the move
+        int32_t _endPositionX, _endPositionY;
+        double _length;
+        double _distance;
+        uint16_t _speed;
+        // The speed profile for the rest of the current move, from
+        // _profileDistance: a ramp from _entrySpeed to _cruiseSpeed, then a
+        // ramp down to _exitSpeed at the end. _elapsed is how long (s) it
+        // has been going, as of _lastPathTime.
+        double _profileDistance;
+        double _entrySpeed, _cruiseSpeed, _exitSpeed;
+        double _rampTime, _cruiseTime, _brakeTime;
+        double _elapsed;
+        unsigned long _lastPathTime;
+        // A line goes in the direction of the unit vector (_ux, _uy)
+        double _ux, _uy;
+        // An arc goes around the center, from _startAngle through _sweep (radians)
+        int32_t _centerX, _centerY;
+        double _radius;
+        double _startAngle, _sweep;
+
+        // A new move starts at the end of the last one, if we were moving
+        // together, and from where the motors are otherwise.
+        void _currentPoint(int32_t *x, int32_t *y)
+        {
+            if( _segment != BRICKTRONICS_MOTOR_GROUP_IDLE )
+            {
+                *x = _endX;
+                *y = _endY;
+            }
+            else
+            {
+                _motorsToPoint(_x.getPosition(), _y.getPosition(), x, y);
+            }
+        }
+        // Starts moving from a stop, with nothing queued
+        void _startSegment(void)
+        {
+            _queueCount = 0;
+            _contourIntegral = 0;
+            _maxContourError = 0;
+            _elapsed = 0;
+            _lastPathTime = millis();
+            _lastSample = _lastPathTime - _sampleTimeMS;
+        }
+
+        // Sets up the current move as a line or an arc from the end of the
+        // last one. The end has to be reachable.
+        void _beginLine(int32_t x, int32_t y, uint16_t speed)
+        {
+            _currentPoint(&_startX, &_startY);
+            _setEnd(x, y);
+            double dx = x - _startX;
+            double dy = y - _startY;
+            _length = sqrt(dx * dx + dy * dy);
+            _endX = x;
+            _endY = y;
+            if( _length < 1 )
+            {
+                _ux = 1;
+                _uy = 0;
+            }
+            else
+            {
+                _ux = dx / _length;
+                _uy = dy / _length;
+            }
+            _segment = BRICKTRONICS_MOTOR_GROUP_LINE;
+            _lastX = x;
+            _lastY = y;
+            _lastDirectionX = _ux;
+            _lastDirectionY = _uy;
+            _startMove(speed, 0);
+        }
+        void _beginArc(int32_t centerX, int32_t centerY, int16_t degrees, uint16_t speed)
+        {
+            _currentPoint(&_startX, &_startY);
+            _arcShape(_startX, _startY, centerX, centerY, degrees, &_radius, &_startAngle, &_sweep, &_endX, &_endY);
+            _setEnd(_endX, _endY);
+            _centerX = centerX;
+            _centerY = centerY;
+            _length = fabs(_sweep) * _radius;
+            if( _radius < 1 )
+            {
+                // There's no arc to follow, we're already there
+                _length = 0;
+            }
+            _segment = BRICKTRONICS_MOTOR_GROUP_ARC;
+            double turn = _sweep < 0 ? -1 : 1;
+            _lastX = _endX;
+            _lastY = _endY;
+            _lastDirectionX = -turn * sin(_startAngle + _sweep);
+            _lastDirectionY = turn * cos(_startAngle + _sweep);
+            _startMove(speed, _radius);
+        }
+        void _startMove(uint16_t speed, double radius)
+        {
+            _speed = speed;
+            _lastSpeed = _speedLimit(speed, radius);
+            _distance = 0;
+            _profileDistance = 0;
+        }
+
+        // Where an arc from (startX, startY) ends, and its radius, starting
+        // angle and sweep (radians)
+        static void _arcShape(int32_t startX, int32_t startY, int32_t centerX, int32_t centerY, int16_t degrees, double *radius, double *startAngle, double *sweep, int32_t *endX, int32_t *endY)
+        {
+            double dx = startX - centerX;
+            double dy = startY - centerY;
+            *radius = sqrt(dx * dx + dy * dy);
+            *startAngle = atan2(dy, dx);
+            *sweep = degrees * PI / 180;
+            double angle = *startAngle + *sweep;
+            *endX = lround(centerX + *radius * cos(angle));
+            *endY = lround(centerY + *radius * sin(angle));
+        }
+
+        // The top speed of a move: on an arc, the speed that keeps the
+        // acceleration towards the center within the limit
+        double _speedLimit(uint16_t speed, double radius)
+        {
+            if( _acceleration > 0 && radius > 0 )
+            {
+                return min((double) speed, sqrt(_acceleration * radius));
+            }
+            return speed;
+        }
+
+        // The nth move in the queue
+        BricktronicsMotorGroupMove &_queuedMove(uint8_t n)
+        {
+            return _queue[( _queueFirst + n ) % _queueSize];
+        }
+
+        // Where the next queued move will start
+        void _queueEnd(int32_t *x, int32_t *y)
+        {
+            if( _queueCount > 0 )
+            {
+                *x = _lastX;
+                *y = _lastY;
+            }
+            else
+            {
+                _currentPoint(x, y);
+            }
+        }
+
+        // True while the current move still has some way to go
+        bool _moving(void)
+        {
+            return _segment != BRICKTRONICS_MOTOR_GROUP_IDLE && _elapsed < _rampTime + _cruiseTime + _brakeTime;
+        }
+
+        // Finishes queueing a move, given the directions it starts and ends
+        // going in, its top speed and its end, and plans the queue again.
+        void _addMove(BricktronicsMotorGroupMove &move, double startDirectionX, double startDirectionY, double endDirectionX, double endDirectionY, double speed, int32_t endX, int32_t endY)
+        {
+            bool moving = _moving();
+            move.maxEntrySpeed = 0;
+            move.entrySpeed = 0;
+            if( moving || _queueCount > 0 )
+            {
+                // The corner with the move before: the cosine of the angle
+                // between them is 1 going straight on, and -1 for a U-turn.
+                double cosine = _lastDirectionX * startDirectionX + _lastDirectionY * startDirectionY;
+                double sinHalf = sqrt(0.5 * ( 1 + cosine ));
+                move.maxEntrySpeed = min(speed, _lastSpeed);
+                if( sinHalf < 0.9999 )
+                {
+                    double corner = sqrt(_acceleration * _junctionDeviation * sinHalf / ( 1 - sinHalf ));
+                    move.maxEntrySpeed = min(move.maxEntrySpeed, corner);
+                }
+            }
+            _queueCount++;
+            _lastX = endX;
+            _lastY = endY;
+            _lastDirectionX = endDirectionX;
+            _lastDirectionY = endDirectionY;
+            _lastSpeed = speed;
+            if( !moving && _queueCount == 1 )
+            {
+                // Nothing to wait for, so start it now
+                _startSegment();
+                _queueCount = 1;
+                _nextMove();
+            }
+            _plan();
+        }
+
+        // Makes the first queued move the current one
+        void _nextMove(void)
+        {
+            BricktronicsMotorGroupMove &move = _queue[_queueFirst];
+            _queueFirst = ( _queueFirst + 1 ) % _queueSize;
+            _queueCount--;
+            // Don't let this change where the queue ends
+            int32_t lastX = _lastX, lastY = _lastY;
+            double lastDirectionX = _lastDirectionX, lastDirectionY = _lastDirectionY, lastSpeed = _lastSpeed;
+            if( move.type == BRICKTRONICS_MOTOR_GROUP_LINE )
+            {
+                _beginLine(move.x, move.y, move.speed);
+            }
+            else
+            {
+                _beginArc(move.x, move.y, move.degrees, move.speed);
+            }
+            _lastX = lastX;
+            _lastY = lastY;
+            _lastDirectionX = lastDirectionX;
+            _lastDirectionY = lastDirectionY;
+            _lastSpeed = lastSpeed;
+            _setProfile(move.entrySpeed, _queueCount > 0 ? _queuedMove(0).entrySpeed : 0);
+        }
+
+        // The look-ahead. Each queued move starts as fast as its corner
+        // allows, as long as it (and every move after it) can still slow
+        // down in time, ending in a stop at the end of the queue. That's
+        // worked out backwards from the end. Then forwards from the current
+        // move, which carries on from where it is at the speed it's going,
+        // each move has to be able to get up to its starting speed.
+        void _plan(void)
+        {
+            if( _acceleration == 0 )
+            {
+                return;
+            }
+            double speed = 0;
+            for( uint8_t i = _queueCount; i > 0; i-- )
+            {
+                BricktronicsMotorGroupMove &move = _queuedMove(i - 1);
+                speed = min(move.maxEntrySpeed, sqrt(speed * speed + 2 * _acceleration * move.length));
+                move.entrySpeed = speed;
+            }
+            if( _moving() )
+            {
+                double now;
+                _profileDistance += _profileAt(_elapsed, &now);
+                _elapsed = 0;
+                speed = min(speed, sqrt(now * now + 2 * _acceleration * ( _length - _profileDistance )));
+                _setProfile(now, speed);
+            }
+            else
+            {
+                // The current move is already done (the next update() moves
+                // on), so it ends at the speed it ends at.
+                speed = _exitSpeed;
+            }
+            for( uint8_t i = 0; i < _queueCount; i++ )
+            {
+                BricktronicsMotorGroupMove &move = _queuedMove(i);
+                move.entrySpeed = min(move.entrySpeed, speed);
+                speed = sqrt(move.entrySpeed * move.entrySpeed + 2 * _acceleration * move.length);
+            }
+        }
+
+        // Sets the speed profile for the rest of the current move, from
+        // entrySpeed to exitSpeed, as fast as the move and the acceleration
+        // limit allow.
+        void _setProfile(double entrySpeed, double exitSpeed)
+        {
+            double length = _length - _profileDistance;
+            double cruise = _speedLimit(_speed, _segment == BRICKTRONICS_MOTOR_GROUP_ARC ? _radius : 0);
+            if( _acceleration == 0 )
+            {
+                entrySpeed = cruise;
+                exitSpeed = cruise;
+            }
+            else
+            {
+                exitSpeed = min(exitSpeed, sqrt(entrySpeed * entrySpeed + 2 * _acceleration * length));
+                cruise = max(cruise, max(entrySpeed, exitSpeed));
+                double ramp = ( cruise * cruise - entrySpeed * entrySpeed ) / ( 2 * _acceleration );
+                double brake = ( cruise * cruise - exitSpeed * exitSpeed ) / ( 2 * _acceleration );
+                if( ramp + brake > length )
+                {
+                    // Too short to get up to speed
+                    cruise = sqrt(_acceleration * length + ( entrySpeed * entrySpeed + exitSpeed * exitSpeed ) / 2);
+                }
+            }
+            _entrySpeed = entrySpeed;
+            _cruiseSpeed = cruise;
+            _exitSpeed = exitSpeed;
+            _rampTime = _acceleration > 0 ? ( cruise - entrySpeed ) / _acceleration : 0;
+            _brakeTime = _acceleration > 0 ? ( cruise - exitSpeed ) / _acceleration : 0;
+            double rampsDistance = ( entrySpeed + cruise ) / 2 * _rampTime + ( cruise + exitSpeed ) / 2 * _brakeTime;
+            if( cruise > 0 )
+            {
+                _cruiseTime = max(0.0, ( length - rampsDistance ) / cruise);
+            }
+            else
+            {
+                // A speed of 0 never gets anywhere
+                _cruiseTime = length > 0 ? 1e30 : 0;
+            }
+        }
+
+        // How far along the profile (ticks) the move is after time (s), and
+        // how fast it's going there
+        double _profileAt(double time, double *speed)
+        {
+            double distance = 0;
+            if( time < _rampTime )
+            {
+                *speed = _entrySpeed + ( _cruiseSpeed - _entrySpeed ) * time / _rampTime;
+                return ( _entrySpeed + *speed ) / 2 * time;
+            }
+            distance += ( _entrySpeed + _cruiseSpeed ) / 2 * _rampTime;
+            time -= _rampTime;
+            if( time < _cruiseTime )
+            {
+                *speed = _cruiseSpeed;
+                return distance + _cruiseSpeed * time;
+            }
+            distance += _cruiseSpeed * _cruiseTime;
+            time -= _cruiseTime;
+            if( time < _brakeTime )
+            {
+                *speed = _cruiseSpeed - ( _cruiseSpeed - _exitSpeed ) * time / _brakeTime;
+                return distance + ( _cruiseSpeed + *speed ) / 2 * time;
+            }
+            *speed = _exitSpeed;
+            return _length - _profileDistance;
+        }
+
+        // True if the arm (if there is one) can reach (x, y)
+        bool _canReach(int32_t x, int32_t y)
+        {
+            int32_t positionX, positionY;
+            return !_arm || _arm->inverse(x, y, &positionX, &positionY);
+        }
+
+        // Works out the motor positions at the end of the move, or returns
+        // false if the arm can't reach it.
+        bool _setEnd(int32_t x, int32_t y)
+        {
+            int32_t positionX = x, positionY = y;
+            if( _arm && !_arm->inverse(x, y, &positionX, &positionY) )
+            {
+                return false;
+            }
+            _endPositionX = positionX;
+            _endPositionY = positionY;
+            return true;
+        }
+
+        // Converts motor positions to a point on the path, which is the same
+        // thing unless there's an arm attached.
+        void _motorsToPoint(int32_t positionX, int32_t positionY, int32_t *x, int32_t *y)
+        {
+            if( _arm )
+            {
+                _arm->forward(positionX, positionY, x, y);
+            }
+            else
+            {
+                *x = positionX;
+                *y = positionY;
+            }
+        }
+
+        // Moves the reference point, measures the contour error, and sends
+        // both motors their corrected setpoints.
+        void _updatePath(unsigned long now)
+        {
+            _elapsed += ( now - _lastPathTime ) / 1000.0;
+            _lastPathTime = now;
+            // Move on to the next queued move once this one is done, with
+            // the time left over
+            while( _queueCount > 0 && !_moving() )
+            {
+                _elapsed -= _rampTime + _cruiseTime + _brakeTime;
+                _nextMove();
+            }
+            double speed;
+            _distance = _profileDistance + _profileAt(_elapsed, &speed);
+            if( _distance > _length )
+            {
+                _distance = _length;
+            }
+
+            // Snapshot both encoders together, so the contour error isn't
+            // skewed by one axis moving between the two readings.
+            int32_t px, py;
+            Encoder::readPair(_x._encoder, _y._encoder, &px, &py);
+            _motorsToPoint(px, py, &px, &py);
+
+            // The reference point, and the unit vector (nx, ny) across the path
+            double rx, ry, nx, ny;
+            if( _segment == BRICKTRONICS_MOTOR_GROUP_LINE )
+            {
+                rx = _startX + _ux * _distance;
+                ry = _startY + _uy * _distance;
+                nx = -_uy;
+                ny = _ux;
+                _contourError = ( px - _startX ) * nx + ( py - _startY ) * ny;
+            }
+            else
+            {
+                double angle = _startAngle;
+                if( _length > 0 )
+                {
+                    angle += _sweep * _distance / _length;
+                }
+                nx = cos(angle);
+                ny = sin(angle);
+                rx = _centerX + _radius * nx;
+                ry = _centerY + _radius * ny;
+                double dx = px - _centerX;
+                double dy = py - _centerY;
+                _contourError = sqrt(dx * dx + dy * dy) - _radius;
+            }
+            if( fabs(_contourError) > _maxContourError )
+            {
+                _maxContourError = fabs(_contourError);
+            }
+
+            double correction = 0;
+            if( _crossCoupling )
+            {
+                _contourIntegral += _contourError * _sampleTimeMS / 1000;
+                _contourIntegral = constrain(_contourIntegral, -BRICKTRONICS_MOTOR_GROUP_CONTOUR_MAX_INTEGRAL, BRICKTRONICS_MOTOR_GROUP_CONTOUR_MAX_INTEGRAL);
+                correction = _contourKp * _contourError + _contourKi * _contourIntegral;
+            }
+            int32_t targetX = lround(rx - correction * nx);
+            int32_t targetY = lround(ry - correction * ny);
+            if( _arm )
+            {
+                // Points the arm can't reach are skipped, and the motors wait
+                // at the last one it could.
+                if( !_arm->inverse(targetX, targetY, &targetX, &targetY) )
+                {
+                    return;
+                }
+            }
+            _x.goToPosition(targetX);
+            _y.goToPosition(targetY);
+        }
+};
+
+// The usual group, of motors with PID position control
+typedef BricktronicsControlledMotorGroup<BricktronicsPIDController> BricktronicsMotorGroup;
+
+#endif // #ifndef BRICKTRONICSMOTORGROUP_H
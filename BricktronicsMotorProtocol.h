@@ -0,0 +1,443 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSMOTORPROTOCOL_H
+#define BRICKTRONICSMOTORPROTOCOL_H
+
+// Runs motors from commands sent by a computer over Serial (or any other
+// Stream), in a compact binary protocol (see utility/BricktronicsProtocol.h
+// for the frames and commands).
+//
+// A sketch that reads a line of text for each command and prints "OK" back
+// spends most of its time waiting: the computer can't send the next command
+// until it gets the answer to the last one, and each of those round trips
+// takes a few milliseconds over USB. Here, commands are queued up instead:
+// every frame is answered as soon as it arrives, with how much room is left
+// in the queue, so the computer can keep sending as long as there's room.
+// The commands then run one after another while the next ones are still
+// arriving. Queries and stops don't wait in the queue.
+//
+// Every frame has a CRC and a sequence number, so a frame that gets garbled
+// is noticed (the next one is answered with the sequence number that's
+// missing, and the rest are dropped until it comes), and a frame that's sent
+// twice (because its answer was lost) only runs once.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsMotor.h"
+#include "BricktronicsMotorGroup.h"
+#include "utility/BricktronicsProtocol.h"
+
+// A queued command, see the constructor. Make an array of these for the
+// protocol to keep the queue in.
+typedef struct BricktronicsProtocolCommand
+{
+   uint8_t command;
+   uint8_t length;
+   uint8_t payload[BRICKTRONICS_PROTOCOL_MAX_COMMAND];
+} BricktronicsProtocolCommand;
+
+template <class Controller>
+class BricktronicsControlledMotorProtocol
+{
+    public:
+        // Commands come in on the stream, for count motors (up to 6).
+        // motors is an array of pointers to the motors, and queue an array
+        // of queueSize commands. None of these are copied, so they need to
+        // stay around (global variables are easiest).
+        BricktronicsControlledMotorProtocol(Stream &stream, BricktronicsControlledMotor<Controller> **motors, uint8_t count, BricktronicsProtocolCommand *queue, uint8_t queueSize):
+            _stream(stream),
+            _motors(motors),
+            _count(count > BRICKTRONICS_PROTOCOL_MAX_MOTORS ? BRICKTRONICS_PROTOCOL_MAX_MOTORS : count),
+            _group(NULL),
+            _queue(queue),
+            _queueSize(queueSize),
+            _queueFirst(0),
+            _queueCount(0),
+            _running(false),
+            _chained(false),
+            _expected(0),
+            _rejected(false),
+            _errors(0)
+        {
+        }
+
+        // Lines and arcs go to this group's queue (see setQueue() in
+        // BricktronicsMotorGroup.h). The group is not copied, so it needs to
+        // stay around (a global variable is easiest). Pass NULL to stop using
+        // it.
+        void setGroup(BricktronicsControlledMotorGroup<Controller> *group)
+        {
+            _group = group;
+        }
+        BricktronicsControlledMotorGroup<Controller> *getGroup(void)
+        {
+            return _group;
+        }
+
+        // Call this (instead of each motor's and the group's update()) as
+        // often as you can. It reads and answers whatever has arrived, runs
+        // the queue, and updates the group and all the motors.
+        void update(void)
+        {
+            int available = _stream.available();
+            while( available-- > 0 )
+            {
+                if( _decoder.decode(_stream.read()) )
+                {
+                    _handleFrame();
+                }
+            }
+            _run();
+            if( _group )
+            {
+                _group->update();
+            }
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                // The group already updated its own motors
+                if( !_group || ( _motors[i] != &_group->_x && _motors[i] != &_group->_y ) )
+                {
+                    _motors[i]->update();
+                }
+            }
+        }
+
+        // How many commands are in the queue, including the one running now
+        uint8_t getQueued(void)
+        {
+            return _queueCount;
+        }
+
+        // How many frames were dropped for a bad CRC or length
+        uint16_t getFrameErrors(void)
+        {
+            return _decoder.getErrors();
+        }
+
+        // How many queued commands couldn't be run (a line or arc with no
+        // group, or that the group's arm can't reach)
+        uint16_t getCommandErrors(void)
+        {
+            return _errors;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        Stream &_stream;
+        BricktronicsControlledMotor<Controller> **_motors;
+        uint8_t _count;
+        BricktronicsControlledMotorGroup<Controller> *_group;
+        BricktronicsFrameDecoder _decoder;
+
+        // The queue, in a circular buffer. The first command is the one
+        // running, started at _startTime. A timed move that follows another
+        // one starts when that one ends, rather than when update() gets to
+        // it, so a stream of them doesn't fall behind.
+        BricktronicsProtocolCommand *_queue;
+        uint8_t _queueSize, _queueFirst, _queueCount;
+        bool _running;
+        bool _chained;
+        unsigned long _startTime;
+
+        // The sequence number of the next frame, and whether the last frame
+        // wasn't taken (so the ones after it are dropped without an answer)
+        uint8_t _expected;
+        bool _rejected;
+        uint16_t _errors;
+
+        void _handleFrame(void)
+        {
+            uint8_t sequence = _decoder.getSequence();
+            uint8_t command = _decoder.getCommand();
+            uint8_t length = _decoder.getLength();
+            const uint8_t *payload = _decoder.getPayload();
+            uint8_t frame[BRICKTRONICS_PROTOCOL_MAX_PAYLOAD + BRICKTRONICS_PROTOCOL_OVERHEAD];
+            // The reply's payload, after its status and room
+            uint8_t *reply = frame + 6;
+
+            if( command == BRICKTRONICS_PROTOCOL_PING )
+            {
+                _expected = sequence + 1;
+                _rejected = false;
+                reply[0] = BRICKTRONICS_PROTOCOL_VERSION;
+                reply[1] = _count;
+                _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_OK, 2);
+                return;
+            }
+            if( sequence != _expected )
+            {
+                // Up to half way around behind is a frame we've already had
+                if( (uint8_t) ( _expected - sequence ) <= 128 )
+                {
+                    _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_DUPLICATE, 0);
+                }
+                else if( !_rejected )
+                {
+                    reply[0] = _expected;
+                    _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_OUT_OF_SEQUENCE, 1);
+                    _rejected = true;
+                }
+                return;
+            }
+            _rejected = false;
+
+            uint8_t mask = length > 0 ? payload[0] : 0;
+            uint8_t motors = BricktronicsProtocol::countMotors(mask);
+            bool maskOK = length > 0 && ( mask >> _count ) == 0;
+            bool queued = false;
+            bool good = false;
+            switch( command )
+            {
+                case BRICKTRONICS_PROTOCOL_STATUS:
+                    good = maskOK && length == 1;
+                    break;
+                case BRICKTRONICS_PROTOCOL_STOP:
+                    good = maskOK && length == 1;
+                    break;
+                case BRICKTRONICS_PROTOCOL_MOVE:
+                    good = maskOK && length == 3 + 4 * motors;
+                    queued = true;
+                    break;
+                case BRICKTRONICS_PROTOCOL_SPEED:
+                    good = maskOK && length == 1 + 2 * motors;
+                    queued = true;
+                    break;
+                case BRICKTRONICS_PROTOCOL_LINE:
+                    good = length == 10;
+                    queued = true;
+                    break;
+                case BRICKTRONICS_PROTOCOL_ARC:
+                    good = length == 12;
+                    queued = true;
+                    break;
+            }
+            // A queued command has to fit in a queue slot
+            if( !good || ( queued && length > BRICKTRONICS_PROTOCOL_MAX_COMMAND ) )
+            {
+                _expected++;
+                _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_BAD_COMMAND, 0);
+                return;
+            }
+            if( queued )
+            {
+                if( _queueCount >= _queueSize )
+                {
+                    // Not taken, so the sequence number stays the same
+                    _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_QUEUE_FULL, 0);
+                    _rejected = true;
+                    return;
+                }
+                BricktronicsProtocolCommand &slot = _queue[( _queueFirst + _queueCount ) % _queueSize];
+                slot.command = command;
+                slot.length = length;
+                for( uint8_t i = 0; i < length; i++ )
+                {
+                    slot.payload[i] = payload[i];
+                }
+                _queueCount++;
+                _expected++;
+                _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_OK, 0);
+                return;
+            }
+
+            _expected++;
+            uint8_t replyLength = 0;
+            if( command == BRICKTRONICS_PROTOCOL_STATUS )
+            {
+                reply[0] = _queueCount > 0 || ( _group && !_group->settled() );
+                replyLength = 1;
+                for( uint8_t i = 0; i < _count; i++ )
+                {
+                    if( mask & ( 1 << i ) )
+                    {
+                        BricktronicsProtocol::putInt32(reply + replyLength, _motors[i]->getPosition());
+                        BricktronicsProtocol::putInt16(reply + replyLength + 4, _motors[i]->getSpeed());
+                        reply[replyLength + 6] = _motors[i]->_mode;
+                        replyLength += 7;
+                    }
+                }
+            }
+            else
+            {
+                // Stop
+                _queueCount = 0;
+                _running = false;
+                if( _group )
+                {
+                    _group->stop();
+                }
+                for( uint8_t i = 0; i < _count; i++ )
+                {
+                    if( mask & ( 1 << i ) )
+                    {
+                        _motors[i]->hold();
+                    }
+                }
+            }
+            _reply(frame, sequence, command, BRICKTRONICS_PROTOCOL_OK, replyLength);
+        }
+
+        // Sends a reply, whose payload (after the status and room) is
+        // already in place in frame.
+        void _reply(uint8_t *frame, uint8_t sequence, uint8_t command, uint8_t status, uint8_t length)
+        {
+            frame[4] = status;
+            frame[5] = _queueSize - _queueCount;
+            length = BricktronicsProtocol::encode(frame, sequence, command | BRICKTRONICS_PROTOCOL_REPLY, frame + 4, length + 2);
+            _stream.write(frame, length);
+        }
+
+        // Runs the queue: starts the first command, and moves on once it's
+        // done.
+        void _run(void)
+        {
+            while( _queueCount > 0 )
+            {
+                BricktronicsProtocolCommand &command = _queue[_queueFirst];
+                if( !_running )
+                {
+                    if( !_start(command) )
+                    {
+                        // Try again on the next update()
+                        return;
+                    }
+                    if( !_chained )
+                    {
+                        _startTime = millis();
+                    }
+                    _chained = false;
+                    _running = true;
+                }
+                uint16_t durationMS = 0;
+                if( command.command == BRICKTRONICS_PROTOCOL_MOVE )
+                {
+                    durationMS = BricktronicsProtocol::getInt16(command.payload + 1);
+                    if( durationMS > 0 ? millis() - _startTime < durationMS : !_settled(command) )
+                    {
+                        return;
+                    }
+                }
+                _running = false;
+                _queueFirst = ( _queueFirst + 1 ) % _queueSize;
+                _queueCount--;
+                if( durationMS > 0 && _queueCount > 0 )
+                {
+                    _startTime += durationMS;
+                    _chained = true;
+                }
+            }
+            _chained = false;
+        }
+
+        // Starts a command. Returns false if it has to wait (for room in the
+        // group's queue).
+        bool _start(BricktronicsProtocolCommand &command)
+        {
+            const uint8_t *payload = command.payload;
+            uint8_t value = command.command == BRICKTRONICS_PROTOCOL_MOVE ? 3 : 1;
+            switch( command.command )
+            {
+                case BRICKTRONICS_PROTOCOL_MOVE:
+                case BRICKTRONICS_PROTOCOL_SPEED:
+                    for( uint8_t i = 0; i < _count; i++ )
+                    {
+                        if( !( payload[0] & ( 1 << i ) ) )
+                        {
+                            continue;
+                        }
+                        if( command.command == BRICKTRONICS_PROTOCOL_MOVE )
+                        {
+                            _motors[i]->goToPosition(BricktronicsProtocol::getInt32(payload + value));
+                            value += 4;
+                        }
+                        else
+                        {
+                            _motors[i]->setSpeed(BricktronicsProtocol::getInt16(payload + value));
+                            value += 2;
+                        }
+                    }
+                    return true;
+                default:
+                    if( !_group )
+                    {
+                        _errors++;
+                        return true;
+                    }
+                    if( _group->_queueSize > 0 && _group->getQueued() >= _group->_queueSize )
+                    {
+                        return false;
+                    }
+                    int32_t x = BricktronicsProtocol::getInt32(payload);
+                    int32_t y = BricktronicsProtocol::getInt32(payload + 4);
+                    bool added;
+                    if( command.command == BRICKTRONICS_PROTOCOL_LINE )
+                    {
+                        added = _group->addLine(x, y, BricktronicsProtocol::getInt16(payload + 8));
+                    }
+                    else
+                    {
+                        added = _group->addArc(x, y, BricktronicsProtocol::getInt16(payload + 8), BricktronicsProtocol::getInt16(payload + 10));
+                    }
+                    if( !added )
+                    {
+                        _errors++;
+                    }
+                    return true;
+            }
+        }
+
+        // True once all the motors in a move have settled at their positions
+        bool _settled(BricktronicsProtocolCommand &command)
+        {
+            uint8_t value = 3;
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                if( command.payload[0] & ( 1 << i ) )
+                {
+                    if( !_motors[i]->settledAtPosition(BricktronicsProtocol::getInt32(command.payload + value)) )
+                    {
+                        return false;
+                    }
+                    value += 4;
+                }
+            }
+            return true;
+        }
+};
+
+// The usual protocol, for motors with PID position control
+typedef BricktronicsControlledMotorProtocol<BricktronicsPIDController> BricktronicsMotorProtocol;
+
+#endif // #ifndef BRICKTRONICSMOTORPROTOCOL_H
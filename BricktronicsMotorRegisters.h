@@ -0,0 +1,293 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSMOTORREGISTERS_H
+#define BRICKTRONICSMOTORREGISTERS_H
+
+// Turns an Arduino running motors into a co-processor for another one (the
+// master), over I2C or SPI. The master reads and writes a block of registers
+// for each motor (see utility/BricktronicsRegisters.h for the map), and this
+// Arduino does all the control loop work.
+//
+// The bus is run from interrupts, which can come in the middle of update().
+// So that they never have to wait for it, or see half of one update() and
+// half of the next, the registers are kept in two copies: update() fills in
+// the back copy, and then swaps it to the front, and the bus reads from the
+// front copy. If a (slow, SPI) transaction is still reading a copy when
+// update() wants to fill it in, update() leaves it alone until next time.
+// Writes from the bus are kept aside until the transaction is over, and
+// update() picks them up.
+//
+// Call busStart(), busWrite(), busRead() and busStop() from your I2C or SPI
+// interrupt handlers, see the MotorCoprocessor example.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsMotor.h"
+#include "utility/BricktronicsRegisters.h"
+
+// Which registers a file has had written, see dirty below
+#define BRICKTRONICS_MOTOR_REGISTERS_WRITTEN_COMMAND        0x01
+#define BRICKTRONICS_MOTOR_REGISTERS_WRITTEN_GAINS          0x02
+
+// The registers of one motor. Make an array of these, one for each motor, for
+// the co-processor to keep them in.
+typedef struct BricktronicsMotorRegisterFile
+{
+   // The two copies the bus reads from, see update()
+   uint8_t snapshot[2][BRICKTRONICS_REGISTERS_MOTOR_SIZE];
+   // What the bus has written, waiting for update()
+   uint8_t written[BRICKTRONICS_REGISTERS_MOTOR_SIZE];
+   volatile uint8_t dirty;
+   // The setpoint in use
+   int32_t setpoint;
+} BricktronicsMotorRegisterFile;
+
+template <class Controller>
+class BricktronicsControlledMotorRegisters
+{
+    public:
+        // Registers for count motors (up to 8). motors is an array of
+        // pointers to the motors, and files an array of count register files.
+        // None of these are copied, so they need to stay around (global
+        // variables are easiest).
+        BricktronicsControlledMotorRegisters(BricktronicsControlledMotor<Controller> **motors, uint8_t count, BricktronicsMotorRegisterFile *files):
+            _motors(motors),
+            _count(count),
+            _files(files),
+            _front(0),
+            _reading(0),
+            _busy(false),
+            _address(0)
+        {
+        }
+
+        // Call this after the motors' begin(), before the bus gets going.
+        void begin(void)
+        {
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                BricktronicsMotorRegisterFile &file = _files[i];
+                memset(&file, 0, sizeof(file));
+                file.written[BRICKTRONICS_REGISTERS_MODE] = _motors[i]->_mode;
+                BricktronicsProtocol::putFloat(file.written + BRICKTRONICS_REGISTERS_KP, _motors[i]->pidGetKp());
+                BricktronicsProtocol::putFloat(file.written + BRICKTRONICS_REGISTERS_KI, _motors[i]->pidGetKi());
+                BricktronicsProtocol::putFloat(file.written + BRICKTRONICS_REGISTERS_KD, _motors[i]->pidGetKd());
+            }
+            _snapshot();
+            _snapshot();
+        }
+
+        // Call this (instead of each motor's update()) as often as you can.
+        // It picks up what the bus has written, updates all the motors, and
+        // takes a new snapshot of the registers for the bus to read.
+        void update(void)
+        {
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                BricktronicsMotorRegisterFile &file = _files[i];
+                uint8_t dirty = 0;
+                uint8_t written[BRICKTRONICS_REGISTERS_MOTOR_SIZE];
+                noInterrupts();
+                if( file.dirty && !_busy )
+                {
+                    dirty = file.dirty;
+                    file.dirty = 0;
+                    memcpy(written, file.written, BRICKTRONICS_REGISTERS_MOTOR_SIZE);
+                }
+                interrupts();
+                if( dirty & BRICKTRONICS_MOTOR_REGISTERS_WRITTEN_COMMAND )
+                {
+                    file.setpoint = BricktronicsProtocol::getInt32(written + BRICKTRONICS_REGISTERS_SETPOINT);
+                    _command(_motors[i], written[BRICKTRONICS_REGISTERS_MODE], file.setpoint);
+                }
+                if( dirty & BRICKTRONICS_MOTOR_REGISTERS_WRITTEN_GAINS )
+                {
+                    _motors[i]->pidSetTunings(BricktronicsProtocol::getFloat(written + BRICKTRONICS_REGISTERS_KP),
+                                              BricktronicsProtocol::getFloat(written + BRICKTRONICS_REGISTERS_KI),
+                                              BricktronicsProtocol::getFloat(written + BRICKTRONICS_REGISTERS_KD));
+                }
+                _motors[i]->update();
+            }
+            _snapshot();
+        }
+
+        // The bus functions, to call from the I2C or SPI interrupt handlers.
+        // A transaction starts with the register address from the master.
+        void busStart(uint8_t address)
+        {
+            _address = address;
+            _reading = _front;
+            _busy = true;
+        }
+
+        // The master writes the next register
+        void busWrite(uint8_t data)
+        {
+            uint8_t motor = _address / BRICKTRONICS_REGISTERS_MOTOR_SIZE;
+            uint8_t offset = _address % BRICKTRONICS_REGISTERS_MOTOR_SIZE;
+            _address++;
+            if( motor >= _count )
+            {
+                return;
+            }
+            BricktronicsMotorRegisterFile &file = _files[motor];
+            if(    offset == BRICKTRONICS_REGISTERS_MODE
+                || ( offset >= BRICKTRONICS_REGISTERS_SETPOINT && offset < BRICKTRONICS_REGISTERS_SETPOINT + 4 ) )
+            {
+                file.written[offset] = data;
+                file.dirty |= BRICKTRONICS_MOTOR_REGISTERS_WRITTEN_COMMAND;
+            }
+            else if( offset >= BRICKTRONICS_REGISTERS_KP && offset < BRICKTRONICS_REGISTERS_KD + 4 )
+            {
+                file.written[offset] = data;
+                file.dirty |= BRICKTRONICS_MOTOR_REGISTERS_WRITTEN_GAINS;
+            }
+        }
+
+        // The master reads the next register. With I2C, where the master
+        // sends the address in one transaction and reads in the next, this
+        // can be called without busStart(), from where the address left off.
+        uint8_t busRead(void)
+        {
+            uint8_t motor = _address / BRICKTRONICS_REGISTERS_MOTOR_SIZE;
+            uint8_t offset = _address % BRICKTRONICS_REGISTERS_MOTOR_SIZE;
+            _address++;
+            if( motor >= _count )
+            {
+                return 0;
+            }
+            BricktronicsMotorRegisterFile &file = _files[motor];
+            uint8_t value = file.snapshot[_busy ? _reading : _front][offset];
+            if( offset == BRICKTRONICS_REGISTERS_STATUS && file.dirty )
+            {
+                value |= BRICKTRONICS_REGISTERS_STATUS_PENDING;
+            }
+            return value;
+        }
+
+        // The end of a transaction
+        void busStop(void)
+        {
+            _busy = false;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        BricktronicsControlledMotor<Controller> **_motors;
+        uint8_t _count;
+        BricktronicsMotorRegisterFile *_files;
+
+        // The snapshot the bus reads, and the one the transaction in progress
+        // (if _busy) started with
+        volatile uint8_t _front;
+        volatile uint8_t _reading;
+        volatile bool _busy;
+        // The next register the bus reads or writes
+        volatile uint8_t _address;
+
+        // Sends a motor into a mode, from the mode and setpoint registers
+        void _command(BricktronicsControlledMotor<Controller> *motor, uint8_t mode, int32_t setpoint)
+        {
+            switch( mode )
+            {
+                case BRICKTRONICS_MOTOR_MODE_COAST:
+                    motor->coast();
+                    break;
+                case BRICKTRONICS_MOTOR_MODE_BRAKE:
+                    motor->brake();
+                    break;
+                case BRICKTRONICS_MOTOR_MODE_FIXED_DRIVE:
+                    motor->setFixedDrive(constrain(setpoint, (int32_t) -255, (int32_t) 255));
+                    break;
+                case BRICKTRONICS_MOTOR_MODE_PID_POSITION:
+                case BRICKTRONICS_MOTOR_MODE_PID_CASCADE:
+                    // Plain position control, if the controller can't do cascaded
+                    motor->setCascadeControl(mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE);
+                    motor->goToPosition(setpoint);
+                    break;
+                case BRICKTRONICS_MOTOR_MODE_PID_SPEED:
+                    motor->setSpeed(constrain(setpoint, (int32_t) -32767, (int32_t) 32767));
+                    break;
+                case BRICKTRONICS_MOTOR_MODE_MIN_TIME:
+                    motor->goToPositionMinTime(setpoint);
+                    break;
+                default:
+                    // The other modes can't be started from the registers
+                    break;
+            }
+        }
+
+        // Fills in the back snapshot and swaps it to the front, unless a
+        // transaction is still reading it.
+        void _snapshot(void)
+        {
+            uint8_t back = _front ^ 1;
+            if( _busy && _reading == back )
+            {
+                return;
+            }
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                BricktronicsControlledMotor<Controller> *motor = _motors[i];
+                BricktronicsMotorRegisterFile &file = _files[i];
+                uint8_t *registers = file.snapshot[back];
+                uint8_t status = 0;
+                if(    ( motor->_mode == BRICKTRONICS_MOTOR_MODE_PID_POSITION || motor->_mode == BRICKTRONICS_MOTOR_MODE_PID_CASCADE )
+                    && motor->settledAtPosition(file.setpoint) )
+                {
+                    status |= BRICKTRONICS_REGISTERS_STATUS_SETTLED;
+                }
+                if( motor->isStalled() )
+                {
+                    status |= BRICKTRONICS_REGISTERS_STATUS_STALLED;
+                }
+                registers[BRICKTRONICS_REGISTERS_MODE] = motor->_mode;
+                registers[BRICKTRONICS_REGISTERS_STATUS] = status;
+                BricktronicsProtocol::putInt32(registers + BRICKTRONICS_REGISTERS_SETPOINT, file.setpoint);
+                BricktronicsProtocol::putInt32(registers + BRICKTRONICS_REGISTERS_POSITION, motor->getPosition());
+                BricktronicsProtocol::putInt16(registers + BRICKTRONICS_REGISTERS_SPEED, motor->getSpeed());
+                BricktronicsProtocol::putInt16(registers + BRICKTRONICS_REGISTERS_OUTPUT, motor->_drive);
+                BricktronicsProtocol::putFloat(registers + BRICKTRONICS_REGISTERS_KP, motor->pidGetKp());
+                BricktronicsProtocol::putFloat(registers + BRICKTRONICS_REGISTERS_KI, motor->pidGetKi());
+                BricktronicsProtocol::putFloat(registers + BRICKTRONICS_REGISTERS_KD, motor->pidGetKd());
+            }
+            _front = back;
+        }
+};
+
+// The usual co-processor, for motors with PID position control
+typedef BricktronicsControlledMotorRegisters<BricktronicsPIDController> BricktronicsMotorRegisters;
+
+#endif // #ifndef BRICKTRONICSMOTORREGISTERS_H
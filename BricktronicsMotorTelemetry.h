@@ -0,0 +1,205 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSMOTORTELEMETRY_H
+#define BRICKTRONICSMOTORTELEMETRY_H
+
+// Streams what the motors' control loops are doing to a computer, as small
+// binary frames, without slowing them down.
+//
+// pidPrintValues() prints three lines of text each time, around 40
+// characters, which takes about 3.5 ms at 115200 baud. Once the serial
+// port's transmit buffer (64 bytes) is full, each print waits for room, and
+// the control loop waits with it. Here, each sample is a 23 byte frame in
+// the format of the serial protocol (see utility/BricktronicsProtocol.h, and
+// BRICKTRONICS_PROTOCOL_TELEMETRY there for what's in it), and a frame is
+// only sent if the transmit buffer has room for all of it right now.
+// Otherwise it's dropped and counted, so a busy serial port costs samples,
+// not time. Sending every few samples (see setDecimation()) keeps the
+// frames from outrunning the serial port.
+//
+// The frames can share the serial port with BricktronicsMotorProtocol.h
+// (the host client picks them out as telemetry).
+//
+// This needs a serial port that has availableForWrite(), which is most of
+// them on recent Arduino versions.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsMotor.h"
+#include "utility/BricktronicsProtocol.h"
+
+#define BRICKTRONICS_TELEMETRY_MAX_MOTORS                   8
+
+template <class Controller>
+class BricktronicsControlledMotorTelemetry
+{
+    public:
+        // Telemetry for count motors (up to 8), to output (usually Serial).
+        // motors is an array of pointers to the motors. Neither is copied,
+        // so they need to stay around (global variables are easiest). No
+        // motors are sent until setMotors().
+        BricktronicsControlledMotorTelemetry(Print &output, BricktronicsControlledMotor<Controller> **motors, uint8_t count):
+            _output(output),
+            _motors(motors),
+            _count(count > BRICKTRONICS_TELEMETRY_MAX_MOTORS ? BRICKTRONICS_TELEMETRY_MAX_MOTORS : count),
+            _mask(0),
+            _decimation(1),
+            _sequence(0),
+            _sent(0),
+            _dropped(0)
+        {
+        }
+
+        // Picks the motors to send, by bit (bit 0 is the first motor)
+        void setMotors(uint8_t mask)
+        {
+            _mask = mask;
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                _lastSample[i] = _motors[i]->_controlSamples;
+                _skipped[i] = 0;
+            }
+        }
+        uint8_t getMotors(void)
+        {
+            return _mask;
+        }
+
+        // Sends a frame for every decimation samples of each motor's control
+        // loop (1, the default, sends every sample).
+        void setDecimation(uint8_t decimation)
+        {
+            _decimation = decimation > 0 ? decimation : 1;
+        }
+        uint8_t getDecimation(void)
+        {
+            return _decimation;
+        }
+
+        // Call this right after updating the motors, as often as you can. It
+        // sends a frame for each motor that has a new sample to send, if
+        // there's room for it, and never waits.
+        void update(void)
+        {
+            for( uint8_t i = 0; i < _count; i++ )
+            {
+                if( !( _mask & ( 1 << i ) ) )
+                {
+                    continue;
+                }
+                BricktronicsControlledMotor<Controller> *motor = _motors[i];
+                uint16_t samples = motor->_controlSamples - _lastSample[i];
+                if( samples == 0 )
+                {
+                    continue;
+                }
+                _lastSample[i] = motor->_controlSamples;
+                _skipped[i] += samples;
+                if( _skipped[i] < _decimation )
+                {
+                    continue;
+                }
+                _skipped[i] = 0;
+                _send(i, motor);
+            }
+        }
+
+        // How many frames have been sent, and how many dropped because the
+        // serial port didn't have room for them
+        uint32_t getSent(void)
+        {
+            return _sent;
+        }
+        uint32_t getDropped(void)
+        {
+            return _dropped;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        Print &_output;
+        BricktronicsControlledMotor<Controller> **_motors;
+        uint8_t _count;
+        uint8_t _mask;
+        uint8_t _decimation;
+        uint8_t _sequence;
+        uint32_t _sent, _dropped;
+
+        // Each motor's sample count as of the last update(), and how many
+        // samples have gone by since its last frame
+        uint16_t _lastSample[BRICKTRONICS_TELEMETRY_MAX_MOTORS];
+        uint16_t _skipped[BRICKTRONICS_TELEMETRY_MAX_MOTORS];
+
+        void _send(uint8_t index, BricktronicsControlledMotor<Controller> *motor)
+        {
+            uint8_t frame[BRICKTRONICS_PROTOCOL_TELEMETRY_SIZE + BRICKTRONICS_PROTOCOL_OVERHEAD];
+            // The sequence number goes up either way, so the computer can
+            // tell how many were dropped.
+            uint8_t sequence = _sequence++;
+            if( _output.availableForWrite() < (int) sizeof(frame) )
+            {
+                _dropped++;
+                return;
+            }
+
+            uint8_t flags = 0;
+            if( motor->isStalled() )
+            {
+                flags |= BRICKTRONICS_PROTOCOL_TELEMETRY_STALLED;
+            }
+            if( abs(motor->_drive) >= 255 )
+            {
+                flags |= BRICKTRONICS_PROTOCOL_TELEMETRY_SATURATED;
+            }
+
+            // The payload goes where encode() puts it, after the header
+            uint8_t *payload = frame + 4;
+            payload[0] = index;
+            BricktronicsProtocol::putInt32(payload + 1, micros());
+            BricktronicsProtocol::putInt32(payload + 5, motor->_loopSetpoint());
+            BricktronicsProtocol::putInt32(payload + 9, motor->getPosition());
+            BricktronicsProtocol::putInt16(payload + 13, motor->_drive);
+            payload[15] = motor->_mode;
+            payload[16] = flags;
+            BricktronicsProtocol::encode(frame, sequence, BRICKTRONICS_PROTOCOL_TELEMETRY, payload, BRICKTRONICS_PROTOCOL_TELEMETRY_SIZE);
+            _output.write(frame, sizeof(frame));
+            _sent++;
+        }
+};
+
+// The usual telemetry, for motors with PID position control
+typedef BricktronicsControlledMotorTelemetry<BricktronicsPIDController> BricktronicsMotorTelemetry;
+
+#endif // #ifndef BRICKTRONICSMOTORTELEMETRY_H
@@ -0,0 +1,112 @@
+// Bricktronics Example: ControllerBenchmark
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example measures how long each of the position controllers takes to
+// compute a new output, which is most of the time spent in the motor's
+// update() function. Pick a controller for your motor with the template
+// parameter, for example:
+//
+//   BricktronicsControlledMotor<BricktronicsFixedPointPIDController> m(...);
+//
+// Plain BricktronicsMotor uses the floating-point PID library.
+//
+// This example doesn't drive any motors, it only needs an Arduino board.
+// The controllers are fed a made-up position that moves towards the setpoint
+// so they go through all of their code paths.
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+
+
+// How many outputs to compute for each controller. Each one takes at least
+// a millisecond, because we wait for the next sample period.
+#define RUNS 200
+
+double input, output, setpoint;
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+}
+
+// Time RUNS calls to Compute() that produce a new output, and return the
+// average time of a single call in microseconds.
+template <class Controller>
+float timeController(Controller &controller)
+{
+  controller.SetOutputLimits(-255, 255);
+  controller.SetSampleTime(1);
+  controller.SetMode(AUTOMATIC);
+
+  // The time it takes to call micros() twice, to subtract from the results
+  unsigned long start = micros();
+  unsigned long overhead = micros() - start;
+
+  unsigned long total = 0;
+  input = 0;
+  setpoint = 500;
+  for (int i = 0; i < RUNS; i++)
+  {
+    // Wait for the next sample period so Compute() does its work
+    unsigned long now = millis();
+    while (millis() == now);
+
+    start = micros();
+    controller.Compute();
+    total += micros() - start - overhead;
+
+    // Pretend the motor moved part of the way towards the setpoint
+    input += (setpoint - input) / 8 + 1;
+  }
+  return (float) total / RUNS;
+}
+
+// Print the results for one controller, with the approximate number of
+// processor cycles as well.
+void printResult(const char *name, float us)
+{
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(us);
+  Serial.print(" us, about ");
+  Serial.print((unsigned long) (us * (F_CPU / 1000000UL)));
+  Serial.println(" cycles per update");
+}
+
+void loop() 
+{
+  Serial.println("");
+  Serial.println("Time to compute one output (micros() counts in 4 us steps on 16 MHz boards, so these are averages):");
+
+  BricktronicsPIDController pid(&input, &output, &setpoint);
+  printResult("PID (floating point)", timeController(pid));
+
+  BricktronicsFixedPointPIDController fixedPid(&input, &output, &setpoint);
+  printResult("PID (fixed point)", timeController(fixedPid));
+
+  BricktronicsStateFeedbackController stateFeedback(&input, &output, &setpoint);
+  printResult("State feedback", timeController(stateFeedback));
+
+  BricktronicsSlidingModeController slidingMode(&input, &output, &setpoint);
+  printResult("Sliding mode", timeController(slidingMode));
+
+  BricktronicsBangBangController bangBang(&input, &output, &setpoint);
+  printResult("Bang-bang", timeController(bangBang));
+
+  delay(5000);
+}
+
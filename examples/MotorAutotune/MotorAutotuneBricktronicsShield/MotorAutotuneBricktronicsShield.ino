@@ -0,0 +1,113 @@
+// Bricktronics Example: MotorAutotuneBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example demonstrates the relay autotuner, which finds PID tuning
+// parameters for the position control of a motor with whatever load you
+// have connected to it. The default PID values were picked for an unloaded
+// NXT motor, so if your motor is turning an arm or a wheel, this is an
+// easy way to get better position control without tuning by hand.
+//
+// During the autotune, the motor swings back and forth around its starting
+// position for a few seconds, so make sure it is free to move a bit.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+
+
+// Select the motor port (MOTOR_1 or MOTOR_2) in the constructor below.
+BricktronicsMotor m(BricktronicsShield::MOTOR_1);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  m.begin();
+
+  // Start the autotune. The first argument is the drive strength used to
+  // swing the motor back and forth, it needs to be strong enough to get
+  // your load moving. The second argument picks the rule used to turn the
+  // measurements into PID values. The "some overshoot" rule is a good start,
+  // try BRICKTRONICS_MOTOR_AUTOTUNE_RULE_NO_OVERSHOOT for a gentler response
+  // or BRICKTRONICS_MOTOR_AUTOTUNE_RULE_ZIEGLER_NICHOLS for a faster one.
+  Serial.print("Autotuning...");
+  m.autotuneStart(100, BRICKTRONICS_MOTOR_AUTOTUNE_RULE_SOME_OVERSHOOT);
+
+  // The autotune doesn't block, it runs a little bit each time we call
+  // update(), so we could be doing other things in this loop too.
+  while (m.autotuneGetStatus() == BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_RUNNING)
+  {
+    m.update();
+  }
+
+  if (m.autotuneGetStatus() == BRICKTRONICS_MOTOR_AUTOTUNE_STATUS_DONE)
+  {
+    Serial.println("done");
+    Serial.print("Ultimate gain: ");
+    Serial.println(m.autotuneGetUltimateGain());
+    Serial.print("Ultimate period (ms): ");
+    Serial.println(m.autotuneGetUltimatePeriodMS());
+  }
+  else
+  {
+    // The motor didn't oscillate, maybe it is stuck or the drive strength
+    // was too small. The PID values were not changed.
+    Serial.println("failed, keeping the old PID values");
+  }
+
+  // These are the values the autotune picked. You can copy them into your
+  // own sketch and use m.pidSetTunings() instead of autotuning every time.
+  Serial.print("Kp: ");
+  Serial.println(m.pidGetKp());
+  Serial.print("Ki: ");
+  Serial.println(m.pidGetKi());
+  Serial.print("Kd: ");
+  Serial.println(m.pidGetKd());
+}
+
+void loop() 
+{
+  // Try out the new PID values
+  Serial.print("Going to position 360...");
+  m.goToPositionWaitForArrivalOrTimeout(360, 3000);
+  Serial.println("done");
+  m.delayUpdateMS(1000);
+
+  Serial.print("Going to position 0...");
+  m.goToPositionWaitForArrivalOrTimeout(0, 3000);
+  Serial.println("done");
+  m.delayUpdateMS(1000);
+}
@@ -0,0 +1,113 @@
+// Bricktronics Example: MotorCoprocessorBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example turns this Arduino into a motor co-processor for another
+// Arduino (the master), over I2C. The master sets each motor's mode and
+// setpoint, and reads back its position, speed and status, through a block of
+// registers for each motor (see utility/BricktronicsRegisters.h for the map,
+// and BricktronicsRegisterMaster for the master's side). This Arduino does
+// all the control loop work.
+//
+// Connect SDA, SCL and ground between the two Arduinos. The master talks to
+// I2C address 0x42.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorRegisters.h>
+
+// The I2C library
+#include <Wire.h>
+
+
+// Select the motor ports (MOTOR_1 and MOTOR_2) in the constructors below.
+BricktronicsMotor mx(BricktronicsShield::MOTOR_1);
+BricktronicsMotor my(BricktronicsShield::MOTOR_2);
+
+// The motors, in register order (mx's registers start at 0x00, my's at 0x20)
+BricktronicsMotor *motors[] = { &mx, &my };
+BricktronicsMotorRegisterFile files[2];
+
+BricktronicsMotorRegisters registers(motors, 2, files);
+
+
+// The master sent us a register address, and maybe some values to write there.
+// An empty write (from a bus scan, say) doesn't have an address, so skip it.
+void receiveEvent(int count)
+{
+  if( count < 1 )
+  {
+    return;
+  }
+  registers.busStart(Wire.read());
+  while( Wire.available() )
+  {
+    registers.busWrite(Wire.read());
+  }
+  registers.busStop();
+}
+
+// The master wants to read, from where the last address left off. We don't
+// know how many bytes it wants, so offer as many as Wire can send.
+void requestEvent()
+{
+  uint8_t data[32];
+  for( uint8_t i = 0; i < 32; i++ )
+  {
+    data[i] = registers.busRead();
+  }
+  Wire.write(data, 32);
+}
+
+void setup()
+{
+  // Answer the master from these functions, once we're on the bus
+  Wire.onReceive(receiveEvent);
+  Wire.onRequest(requestEvent);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+
+  // Get the registers ready before the master can ask for them
+  registers.begin();
+
+  // Join the I2C bus at address 0x42
+  Wire.begin(0x42);
+}
+
+void loop()
+{
+  // This picks up what the master wrote, updates the motors, and takes a new
+  // snapshot of the registers
+  registers.update();
+}
@@ -0,0 +1,113 @@
+// Bricktronics Example: MotorGroupPathBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example shows how to queue up a path of many short lines for a
+// plotter, and let the group plan ahead over them: with an acceleration
+// limit, it only slows down as much as each corner needs, instead of
+// stopping at the end of every line. It draws a star, first stopping at
+// every corner and then with the look-ahead, and prints how long each took.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorGroup.h>
+
+
+// Select the motor ports (MOTOR_1 and MOTOR_2) in the constructors below.
+BricktronicsMotor mx(BricktronicsShield::MOTOR_1);
+BricktronicsMotor my(BricktronicsShield::MOTOR_2);
+
+// The group that moves them together, X first and then Y
+BricktronicsMotorGroup plotter(mx, my);
+
+// Room for eight moves waiting to go
+BricktronicsMotorGroupMove queue[8];
+
+// The points of a five-pointed star, with a few points along each edge
+const int16_t star[][2] = {
+  { 300, 600 }, { 335, 495 }, { 370, 390 }, { 480, 390 }, { 590, 390 },
+  { 500, 325 }, { 410, 260 }, { 445, 155 }, { 480,  50 }, { 390, 115 },
+  { 300, 180 }, { 210, 115 }, { 120,  50 }, { 155, 155 }, { 190, 260 },
+  { 100, 325 }, {  10, 390 }, { 120, 390 }, { 230, 390 }, { 265, 495 },
+  { 300, 600 },
+};
+const uint8_t points = sizeof(star) / sizeof(star[0]);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+
+  plotter.setQueue(queue, 8);
+  // Speed up and slow down at up to 2000 ticks per second per second
+  plotter.setAcceleration(2000);
+}
+
+void drawStar()
+{
+  // Start at the first point
+  plotter.moveLine(star[0][0], star[0][1], 200);
+  plotter.waitForArrivalOrTimeout(5000);
+
+  unsigned long start = millis();
+  uint8_t next = 1;
+  while( next < points || !plotter.settled() )
+  {
+    // Keep the queue topped up, so the group can see what's coming
+    if( next < points && plotter.addLine(star[next][0], star[next][1], 300) )
+    {
+      next++;
+    }
+    plotter.update();
+  }
+  Serial.print(millis() - start);
+  Serial.println(" ms");
+}
+
+void loop()
+{
+  Serial.print("Stopping at every corner: ");
+  plotter.setJunctionDeviation(0);
+  drawStar();
+
+  Serial.print("Planning ahead: ");
+  plotter.setJunctionDeviation(1);
+  drawStar();
+
+  plotter.stop();
+  delay(2000);
+}
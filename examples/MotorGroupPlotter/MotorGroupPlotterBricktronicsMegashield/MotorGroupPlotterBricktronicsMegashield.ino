@@ -0,0 +1,96 @@
+// Bricktronics Example: MotorGroupPlotterBricktronicsMegashield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example shows how to move two motors together along lines and
+// circles, like the X and Y axes of a plotter. The motor group uses
+// cross-coupled contour control to keep the pen on the path, even when one
+// axis is heavier or stiffer than the other. It prints the largest contour
+// error (how far off the path the motors got) after each move, with and
+// without cross-coupling, so you can see the difference on your own machine.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Megashield
+//   https://store.wayneandlayne.com/products/bricktronics-megashield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMegashield library
+//   https://github.com/wayneandlayne/BricktronicsMegashield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMegashield.h>
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorGroup.h>
+
+
+// Select the desired motor ports (MOTOR_1 through MOTOR_6) in the constructors below.
+BricktronicsMotor mx(BricktronicsMegashield::MOTOR_1);
+BricktronicsMotor my(BricktronicsMegashield::MOTOR_2);
+
+// The group that moves them together, X first and then Y
+BricktronicsMotorGroup plotter(mx, my);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+}
+
+void drawShapes()
+{
+  // Start at the origin
+  plotter.moveLine(0, 0, 200);
+  plotter.waitForArrivalOrTimeout(5000);
+
+  // A diagonal line, 600 ticks along each axis, at 300 ticks per second
+  plotter.moveLine(600, 600, 300);
+  plotter.waitForArrivalOrTimeout(10000);
+  Serial.print("  Diagonal: ");
+  Serial.println(plotter.getMaxContourError());
+
+  // Over to the right side of a circle of radius 300 around (600, 600),
+  // then all the way around it
+  plotter.moveLine(900, 600, 200);
+  plotter.waitForArrivalOrTimeout(5000);
+  plotter.moveArc(600, 600, 360, 300);
+  plotter.waitForArrivalOrTimeout(20000);
+  Serial.print("  Circle: ");
+  Serial.println(plotter.getMaxContourError());
+}
+
+void loop()
+{
+  Serial.println("Largest contour errors (ticks) without cross-coupling:");
+  plotter.setCrossCoupling(false);
+  drawShapes();
+
+  Serial.println("Largest contour errors (ticks) with cross-coupling:");
+  plotter.setCrossCoupling(true);
+  drawShapes();
+
+  plotter.stop();
+  delay(2000);
+}
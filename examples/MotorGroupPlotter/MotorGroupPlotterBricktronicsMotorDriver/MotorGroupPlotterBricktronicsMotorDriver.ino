@@ -0,0 +1,110 @@
+// Bricktronics Example: MotorGroupPlotterBricktronicsMotorDriver
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example shows how to move two motors together along lines and
+// circles, like the X and Y axes of a plotter. The motor group uses
+// cross-coupled contour control to keep the pen on the path, even when one
+// axis is heavier or stiffer than the other. It prints the largest contour
+// error (how far off the path the motors got) after each move, with and
+// without cross-coupling, so you can see the difference on your own machine.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Motor Driver
+//   https://store.wayneandlayne.com/products/bricktronics-motor-driver.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorGroup.h>
+
+
+
+// Update the five pin assignments in the constructors below.
+// The arguments are: enPin, dirPin, pwmPin, encoderPin1, encoderPin2
+// There are a few considerations for pin assignments:
+// A. pwmPin needs to be a pin with PWM capabilities (supports analogWrite)
+//      Uno:       pins 3, 5, 6, 9, 10, and 11
+//      Mega 2560: pins 2 to 13 and 44 to 46
+// B. There are three ways to connect the encoder pins (labeled T1/T2 on the board).
+// ** Best performance: Both signals are connected to true interrupt pins (listed below).
+// ** Good performance: The FIRST signal (T1) is connected to an interrupt pin, the second signa is a regular pin. This is the mode used for the Bricktronics Shield/Megashield. For this mode it is CRITICAL that the true interrupt pin is used for T1 and not T2.
+// ** Low performance: Both signals are connected to non-interrupt pins.
+// Regardless of which performance mode used, you MUST list the pin T1 before T2 in
+//   the constructor, otherwise the encoder will be connected backwards and the
+//   PID algorithm will get all confused and freak out.
+// Location of true interrupt pins:
+//      Uno:       pins 2 and 3
+//      Mega 2560: pins 2, 3, 21, 20, 19, and 18
+//
+BricktronicsMotor mx(4, 5, 10, 2, 8);
+BricktronicsMotor my(6, 7, 11, 3, 9);
+
+// The group that moves them together, X first and then Y
+BricktronicsMotorGroup plotter(mx, my);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+}
+
+void drawShapes()
+{
+  // Start at the origin
+  plotter.moveLine(0, 0, 200);
+  plotter.waitForArrivalOrTimeout(5000);
+
+  // A diagonal line, 600 ticks along each axis, at 300 ticks per second
+  plotter.moveLine(600, 600, 300);
+  plotter.waitForArrivalOrTimeout(10000);
+  Serial.print("  Diagonal: ");
+  Serial.println(plotter.getMaxContourError());
+
+  // Over to the right side of a circle of radius 300 around (600, 600),
+  // then all the way around it
+  plotter.moveLine(900, 600, 200);
+  plotter.waitForArrivalOrTimeout(5000);
+  plotter.moveArc(600, 600, 360, 300);
+  plotter.waitForArrivalOrTimeout(20000);
+  Serial.print("  Circle: ");
+  Serial.println(plotter.getMaxContourError());
+}
+
+void loop()
+{
+  Serial.println("Largest contour errors (ticks) without cross-coupling:");
+  plotter.setCrossCoupling(false);
+  drawShapes();
+
+  Serial.println("Largest contour errors (ticks) with cross-coupling:");
+  plotter.setCrossCoupling(true);
+  drawShapes();
+
+  plotter.stop();
+  delay(2000);
+}
@@ -0,0 +1,97 @@
+// Bricktronics Example: MotorIterativeLearningBricktronicsMegashield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example demonstrates iterative learning control, for machines that
+// run the same sequence of moves over and over. The PID makes the same
+// tracking errors on every run, so the library remembers the errors from
+// each run and adds a drive strength correction for the next one. The
+// average tracking error is printed after every run, watch it shrink over
+// the first couple dozen runs.
+//
+// The motor swings back and forth half a turn, so make sure it is free to
+// move.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Megashield
+//   https://store.wayneandlayne.com/products/bricktronics-megashield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMegashield library
+//   https://github.com/wayneandlayne/BricktronicsMegashield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMegashield.h>
+#include <BricktronicsMotor.h>
+
+
+// Select the desired motor port (MOTOR_1 through MOTOR_6) in the constructor below.
+BricktronicsMotor m(BricktronicsMegashield::MOTOR_1);
+
+// The learned corrections, one for each 20 ms of the 1.28 second run
+BricktronicsMotorILC ilc;
+
+// The sequence is a smooth swing out to 360 and back, sent to the motor
+// as a new position every 10 ms.
+#define RUN_MS 1280
+
+uint16_t runs = 0;
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  m.begin();
+
+  // Start using iterative learning control
+  m.setIterativeLearning(&ilc);
+
+  m.goToPositionWaitForArrivalOrTimeout(0, 3000);
+}
+
+void loop() 
+{
+  // Every run has to start at the same point of the sequence
+  m.ilcStartRun();
+  unsigned long start = millis();
+  unsigned long lastMove = 0;
+  while (millis() - start < RUN_MS)
+  {
+    unsigned long t = millis() - start;
+    if (t - lastMove >= 10)
+    {
+      lastMove = t;
+      m.goToPosition(180 - 180 * cos(2 * PI * t / RUN_MS));
+    }
+    m.update();
+  }
+  m.goToPosition(0);
+  m.delayUpdateMS(100);
+
+  runs++;
+  Serial.print("Run ");
+  Serial.print(runs);
+  Serial.print(", average tracking error: ");
+  Serial.println(m.ilcGetRunError());
+}
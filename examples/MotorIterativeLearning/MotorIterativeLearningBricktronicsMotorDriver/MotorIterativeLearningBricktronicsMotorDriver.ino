@@ -0,0 +1,109 @@
+// Bricktronics Example: MotorIterativeLearningBricktronicsMotorDriver
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example demonstrates iterative learning control, for machines that
+// run the same sequence of moves over and over. The PID makes the same
+// tracking errors on every run, so the library remembers the errors from
+// each run and adds a drive strength correction for the next one. The
+// average tracking error is printed after every run, watch it shrink over
+// the first couple dozen runs.
+//
+// The motor swings back and forth half a turn, so make sure it is free to
+// move.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Motor Driver
+//   https://store.wayneandlayne.com/products/bricktronics-motor-driver.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+
+
+// Update the five pin assignments in the constructor below.
+// The arguments are: enPin, dirPin, pwmPin, encoderPin1, encoderPin2
+// There are a few considerations for pin assignments:
+// A. pwmPin needs to be a pin with PWM capabilities (that is, it supports analogWrite)
+//      Uno:       pins 3, 5, 6, 9, 10, and 11
+//      Mega 2560: pins 2 - 13 and 44 - 46
+// B. There are three ways to connect the encoder pins (labeled T1/T2 on the board).
+// ** Best performance: Both signals are connected to true interrupt pins (listed below).
+// ** Good performance: The FIRST signal (T1) is connected to an interrupt pin, the second signal is a regular pin. This is the mode used for the Bricktronics Shield/Megashield. For this mode it is CRITICAL that the true interrupt pin is used for T1 and not T2.
+// ** Low performance: Both signals are connected to non-interrupt pins.
+// Regardless of which performance mode used, you MUST list the pin T1 before T2 in
+//   the constructor, otherwise the encoder will be connected backwards and the
+//   PID algorithm will get all confused and freak out.
+// Location of true interrupt pins:
+//      Uno:       pins 2 and 3
+//      Mega 2560: pins 2, 3, 21, 20, 19, and 18
+BricktronicsMotor m(3, 4, 10, 2, 5);
+
+// The learned corrections, one for each 20 ms of the 1.28 second run
+BricktronicsMotorILC ilc;
+
+// The sequence is a smooth swing out to 360 and back, sent to the motor
+// as a new position every 10 ms.
+#define RUN_MS 1280
+
+uint16_t runs = 0;
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  m.begin();
+
+  // Start using iterative learning control
+  m.setIterativeLearning(&ilc);
+
+  m.goToPositionWaitForArrivalOrTimeout(0, 3000);
+}
+
+void loop() 
+{
+  // Every run has to start at the same point of the sequence
+  m.ilcStartRun();
+  unsigned long start = millis();
+  unsigned long lastMove = 0;
+  while (millis() - start < RUN_MS)
+  {
+    unsigned long t = millis() - start;
+    if (t - lastMove >= 10)
+    {
+      lastMove = t;
+      m.goToPosition(180 - 180 * cos(2 * PI * t / RUN_MS));
+    }
+    m.update();
+  }
+  m.goToPosition(0);
+  m.delayUpdateMS(100);
+
+  runs++;
+  Serial.print("Run ");
+  Serial.print(runs);
+  Serial.print(", average tracking error: ");
+  Serial.println(m.ilcGetRunError());
+}
@@ -0,0 +1,99 @@
+// Bricktronics Example: MotorKeyframesBricktronicsMotorDriver
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example shows how to play back keyframes on two motors at once, like
+// the head and jaw of an animatronic figure. The keyframes are in a table in
+// flash, and the motors follow smooth curves through them.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Motor Driver
+//   https://store.wayneandlayne.com/products/bricktronics-motor-driver.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+#include <BricktronicsKeyframePlayer.h>
+
+
+
+// Update the five pin assignments in the constructors below.
+// The arguments are: enPin, dirPin, pwmPin, encoderPin1, encoderPin2
+// There are a few considerations for pin assignments:
+// A. pwmPin needs to be a pin with PWM capabilities (supports analogWrite)
+//      Uno:       pins 3, 5, 6, 9, 10, and 11
+//      Mega 2560: pins 2 to 13 and 44 to 46
+// B. There are three ways to connect the encoder pins (labeled T1/T2 on the board).
+// ** Best performance: Both signals are connected to true interrupt pins (listed below).
+// ** Good performance: The FIRST signal (T1) is connected to an interrupt pin, the second signa is a regular pin. This is the mode used for the Bricktronics Shield/Megashield. For this mode it is CRITICAL that the true interrupt pin is used for T1 and not T2.
+// ** Low performance: Both signals are connected to non-interrupt pins.
+// Regardless of which performance mode used, you MUST list the pin T1 before T2 in
+//   the constructor, otherwise the encoder will be connected backwards and the
+//   PID algorithm will get all confused and freak out.
+// Location of true interrupt pins:
+//      Uno:       pins 2 and 3
+//      Mega 2560: pins 2, 3, 21, 20, 19, and 18
+//
+BricktronicsMotor head(4, 5, 10, 2, 8);
+BricktronicsMotor jaw(6, 7, 11, 3, 9);
+
+// The player needs a list of the motors, and somewhere to keep track of each
+BricktronicsMotor *motors[] = { &head, &jaw };
+BricktronicsKeyframeAxis axes[2];
+BricktronicsKeyframePlayer player(motors, axes, 2);
+
+// Each keyframe is how long (ms) after the previous one it is, and then a
+// position (ticks, 720 per turn) for each motor. This stays in flash, so
+// long shows don't use up RAM.
+const int16_t show[] PROGMEM = {
+  // ms,  head, jaw
+    1000,  180,    0,   // look left
+     400,  180,   90,   // open the jaw
+     300,  180,    0,   // and close it
+     300,  180,   90,
+     300,  180,    0,
+    1500, -180,    0,   // look right, slowly
+     800,    0,   60,   // back to the middle, with the jaw a bit open
+     500,    0,    0,
+};
+BricktronicsProgmemKeyframes keyframes(show, 8, 2);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  head.begin();
+  jaw.begin();
+
+  // Play the show over and over
+  player.setLooping(true);
+  player.play(&keyframes);
+}
+
+void loop()
+{
+  // This keeps the motors moving along, so call it as often as you can
+  player.update();
+}
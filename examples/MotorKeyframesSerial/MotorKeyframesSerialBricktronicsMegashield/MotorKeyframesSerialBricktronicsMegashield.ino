@@ -0,0 +1,84 @@
+// Bricktronics Example: MotorKeyframesSerialBricktronicsMegashield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example shows how to play a long show of keyframes sent over the
+// serial port, in the compact keyframe format (see
+// BricktronicsKeyframeFormat.h). The show doesn't have to fit in flash or
+// RAM. Send it as a binary file, at 115200 baud, after the Arduino resets,
+// ending with the end marker from BricktronicsKeyframeWriter's end(). If the
+// computer falls behind, the motors wait where they are until it catches up,
+// and the show carries on from there.
+//
+// An SD card File is a Stream too, so the same thing works for a show on an
+// SD card: open the File and give it to BricktronicsCompactKeyframes instead
+// of Serial.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Megashield
+//   https://store.wayneandlayne.com/products/bricktronics-megashield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMegashield library
+//   https://github.com/wayneandlayne/BricktronicsMegashield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMegashield.h>
+#include <BricktronicsMotor.h>
+#include <BricktronicsKeyframeFormat.h>
+
+
+// Select the desired motor ports (MOTOR_1 through MOTOR_6) in the constructors below.
+BricktronicsMotor head(BricktronicsMegashield::MOTOR_1);
+BricktronicsMotor jaw(BricktronicsMegashield::MOTOR_2);
+
+// The player needs a list of the motors, and somewhere to keep track of each
+BricktronicsMotor *motors[] = { &head, &jaw };
+BricktronicsKeyframeAxis axes[2];
+BricktronicsKeyframePlayer player(motors, axes, 2);
+
+// Reads the keyframes as they come in over the serial port
+BricktronicsCompactKeyframes keyframes(Serial);
+
+
+void setup()
+{
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  head.begin();
+  jaw.begin();
+}
+
+void loop()
+{
+  if( !player.isPlaying() && Serial.available() )
+  {
+    // The start of a show. This doesn't wait: until the first keyframe
+    // has come in, it returns false, and we try again next time around.
+    player.play(&keyframes);
+  }
+
+  // This keeps the motors moving along (and reads ahead in the show), so
+  // call it as often as you can
+  player.update();
+}
+
@@ -0,0 +1,98 @@
+// Bricktronics Example: MotorSerialProtocolBricktronicsMotorDriver
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example lets a computer drive two motors over the USB serial port,
+// with the binary motor command protocol (see
+// utility/BricktronicsProtocol.h for how the frames look). The computer can
+// send moves, speeds, and lines and arcs for the pair of motors as a
+// plotter, as fast as the serial port can carry them: every command is
+// answered right away, and queued up to run while the next ones arrive. It
+// can also ask where the motors are, or stop everything, at any time.
+//
+// Nothing is printed, since the serial port is busy with the protocol.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Motor Driver
+//   https://store.wayneandlayne.com/products/bricktronics-motor-driver.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorGroup.h>
+#include <BricktronicsMotorProtocol.h>
+
+
+
+// Update the five pin assignments in the constructors below.
+// The arguments are: enPin, dirPin, pwmPin, encoderPin1, encoderPin2
+// There are a few considerations for pin assignments:
+// A. pwmPin needs to be a pin with PWM capabilities (supports analogWrite)
+//      Uno:       pins 3, 5, 6, 9, 10, and 11
+//      Mega 2560: pins 2 to 13 and 44 to 46
+// B. There are three ways to connect the encoder pins (labeled T1/T2 on the board).
+// ** Best performance: Both signals are connected to true interrupt pins (listed below).
+// ** Good performance: The FIRST signal (T1) is connected to an interrupt pin, the second signa is a regular pin. This is the mode used for the Bricktronics Shield/Megashield. For this mode it is CRITICAL that the true interrupt pin is used for T1 and not T2.
+// ** Low performance: Both signals are connected to non-interrupt pins.
+// Regardless of which performance mode used, you MUST list the pin T1 before T2 in
+//   the constructor, otherwise the encoder will be connected backwards and the
+//   PID algorithm will get all confused and freak out.
+// Location of true interrupt pins:
+//      Uno:       pins 2 and 3
+//      Mega 2560: pins 2, 3, 21, 20, 19, and 18
+//
+BricktronicsMotor mx(4, 5, 10, 2, 8);
+BricktronicsMotor my(6, 7, 11, 3, 9);
+
+// The motors the commands pick from, in order (bit 0 of the mask is mx)
+BricktronicsMotor *motors[] = { &mx, &my };
+
+// The same two motors as a plotter, for lines and arcs
+BricktronicsMotorGroup plotter(mx, my);
+BricktronicsMotorGroupMove plotterQueue[4];
+
+// Room for eight commands waiting to run
+BricktronicsProtocolCommand queue[8];
+
+BricktronicsMotorProtocol protocol(Serial, motors, 2, queue, 8);
+
+
+void setup()
+{
+  // The faster the better. 115200 baud carries around 600 moves a second,
+  // and most boards can go up to 1000000 baud.
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+
+  plotter.setQueue(plotterQueue, 4);
+  plotter.setAcceleration(2000);
+  protocol.setGroup(&plotter);
+}
+
+void loop()
+{
+  // This reads and answers the commands, and updates the plotter and the
+  // motors
+  protocol.update();
+}
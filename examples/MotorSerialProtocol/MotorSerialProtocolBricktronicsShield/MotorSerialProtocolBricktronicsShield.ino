@@ -0,0 +1,87 @@
+// Bricktronics Example: MotorSerialProtocolBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example lets a computer drive two motors over the USB serial port,
+// with the binary motor command protocol (see
+// utility/BricktronicsProtocol.h for how the frames look). The computer can
+// send moves, speeds, and lines and arcs for the pair of motors as a
+// plotter, as fast as the serial port can carry them: every command is
+// answered right away, and queued up to run while the next ones arrive. It
+// can also ask where the motors are, or stop everything, at any time.
+//
+// Nothing is printed, since the serial port is busy with the protocol.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorGroup.h>
+#include <BricktronicsMotorProtocol.h>
+
+
+// Select the motor ports (MOTOR_1 and MOTOR_2) in the constructors below.
+BricktronicsMotor mx(BricktronicsShield::MOTOR_1);
+BricktronicsMotor my(BricktronicsShield::MOTOR_2);
+
+// The motors the commands pick from, in order (bit 0 of the mask is mx)
+BricktronicsMotor *motors[] = { &mx, &my };
+
+// The same two motors as a plotter, for lines and arcs
+BricktronicsMotorGroup plotter(mx, my);
+BricktronicsMotorGroupMove plotterQueue[4];
+
+// Room for eight commands waiting to run
+BricktronicsProtocolCommand queue[8];
+
+BricktronicsMotorProtocol protocol(Serial, motors, 2, queue, 8);
+
+
+void setup()
+{
+  // The faster the better. 115200 baud carries around 600 moves a second,
+  // and most boards can go up to 1000000 baud.
+  Serial.begin(115200);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+
+  plotter.setQueue(plotterQueue, 4);
+  plotter.setAcceleration(2000);
+  protocol.setGroup(&plotter);
+}
+
+void loop()
+{
+  // This reads and answers the commands, and updates the plotter and the
+  // motors
+  protocol.update();
+}
@@ -0,0 +1,109 @@
+// Bricktronics Example: MotorSpeedControlBricktronicsMegashield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example demonstrates motor speed control, which uses a PID loop to
+// hold the motor at a desired speed even when the load changes, and the
+// cascaded position control mode, which stacks a position loop on top of
+// that speed loop for a stiffer and faster goToPosition().
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Megashield
+//   https://store.wayneandlayne.com/products/bricktronics-megashield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMegashield library
+//   https://github.com/wayneandlayne/BricktronicsMegashield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMegashield.h>
+#include <BricktronicsMotor.h>
+
+
+// Select the desired motor port (MOTOR_1 through MOTOR_6) in the constructor below.
+BricktronicsMotor m(BricktronicsMegashield::MOTOR_1);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections
+  m.begin();
+}
+
+// Keep the speed loop running for delayMS milliseconds, printing the
+// measured speed a few times per second.
+void printSpeedForMS(uint32_t delayMS)
+{
+  unsigned long endTime = millis() + delayMS;
+  unsigned long nextPrint = millis();
+  while (millis() < endTime)
+  {
+    m.update();
+    if (millis() >= nextPrint)
+    {
+      Serial.print("Speed: ");
+      Serial.println(m.getSpeed());
+      nextPrint += 250;
+    }
+  }
+}
+
+void loop() 
+{
+  Serial.println("");
+
+  // Speeds are measured in encoder ticks per second. There are 720 ticks
+  // per revolution, so 360 ticks per second is one revolution every two
+  // seconds. Just like with goToPosition(), setSpeed() only sets up the
+  // speed loop, you need to keep calling update() to make the motor move.
+  // Try grabbing the motor while it runs, the drive strength goes up to
+  // keep the speed steady.
+  Serial.println("Running at 360 ticks per second...");
+  m.setSpeed(360);
+  printSpeedForMS(3000);
+
+  Serial.println("Running backwards at 720 ticks per second...");
+  m.setSpeed(-720);
+  printSpeedForMS(3000);
+
+  m.brake();
+  delay(1000);
+
+  // With cascaded control turned on, all of the goToPosition* and goToAngle*
+  // functions (and hold()) use an outer position loop that asks the inner
+  // speed loop for a speed, instead of setting the drive strength directly.
+  // The inner loop runs more often than the outer loop, see
+  // speedPidSetUpdateFrequencyMS() and pidSetUpdateFrequencyMS().
+  Serial.print("Using cascaded control to go to position 720...");
+  m.setCascadeControl(true);
+  m.goToPositionWaitForArrivalOrTimeout(720, 3000);
+  Serial.println("done");
+  m.delayUpdateMS(2000);
+
+  Serial.print("Using single-loop control to go back to position 0...");
+  m.setCascadeControl(false);
+  m.goToPositionWaitForArrivalOrTimeout(0, 3000);
+  Serial.println("done");
+  m.delayUpdateMS(2000);
+}
@@ -0,0 +1,89 @@
+// Bricktronics Example: MotorTelemetryBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example swings two motors back and forth, and streams what their
+// control loops are doing to the computer, as small binary frames (see
+// BricktronicsMotorTelemetry.h, and utility/BricktronicsProtocol.h for how the
+// frames look). Each frame has the time, setpoint, position, drive strength,
+// mode and stall/saturation flags of one motor's control loop sample. Use the
+// host client in extras/host (readTelemetry() and getTelemetry()) to read
+// them and plot them, or save them for later.
+//
+// Unlike pidPrintValues(), this never makes the motors wait for the serial
+// port. If the serial port falls behind, samples are dropped and counted, and
+// the frames' sequence numbers skip ahead so the computer can tell.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+#include <BricktronicsMotorTelemetry.h>
+
+
+// Select the motor ports (MOTOR_1 and MOTOR_2) in the constructors below.
+BricktronicsMotor mx(BricktronicsShield::MOTOR_1);
+BricktronicsMotor my(BricktronicsShield::MOTOR_2);
+
+// The motors to send, in order (bit 0 of the mask is mx)
+BricktronicsMotor *motors[] = { &mx, &my };
+
+BricktronicsMotorTelemetry telemetry(Serial, motors, 2);
+
+
+void setup()
+{
+  // Each frame is 23 bytes, so 115200 baud carries around 500 frames a
+  // second.
+  Serial.begin(115200);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  mx.begin();
+  my.begin();
+
+  // Run the control loops every 5 ms, and send every other sample of both
+  // motors (200 frames a second)
+  mx.pidSetUpdateFrequencyMS(5);
+  my.pidSetUpdateFrequencyMS(5);
+  telemetry.setMotors(0x03);
+  telemetry.setDecimation(2);
+}
+
+void loop()
+{
+  // Swing back and forth, every second
+  int32_t target = ( millis() / 1000 ) % 2 ? 720 : 0;
+  mx.goToPosition(target);
+  my.goToPosition(-target);
+
+  mx.update();
+  my.update();
+  telemetry.update();
+}
@@ -0,0 +1,82 @@
+// Bricktronics Example: MotorTimingBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example swings a motor back and forth, and every five seconds prints
+// how long each update() took, how late the control loop ran compared to its
+// sample time, and how many times it was more than a millisecond late. Each
+// is a count, the smallest, the biggest, the mean (all in microseconds), and
+// a histogram of how many were under 16 us, under 32 us, and so on up to
+// 1024 us and over.
+//
+// Try adding a delay() to loop() to see what that does to the control loop.
+//
+// The timing is only compiled in when BRICKTRONICS_MOTOR_TIMING is defined
+// before including the libraries, so it doesn't cost anything otherwise.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Turn on the timing measurements. This has to come before the includes.
+#define BRICKTRONICS_MOTOR_TIMING
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+
+
+// Select the motor port (MOTOR_1 or MOTOR_2) in the constructor below.
+BricktronicsMotor m(BricktronicsShield::MOTOR_1);
+
+unsigned long lastPrint = 0;
+
+
+void setup()
+{
+  Serial.begin(115200);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  m.begin();
+
+  m.pidSetUpdateFrequencyMS(5);
+}
+
+void loop()
+{
+  // Swing back and forth, every second
+  m.goToPosition(( millis() / 1000 ) % 2 ? 360 : 0);
+  m.update();
+
+  if( millis() - lastPrint >= 5000 )
+  {
+    m.timingPrint(Serial);
+    Serial.println();
+    m.timingReset();
+    lastPrint = millis();
+  }
+}
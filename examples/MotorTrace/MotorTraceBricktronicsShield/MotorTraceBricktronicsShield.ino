@@ -0,0 +1,85 @@
+// Bricktronics Example: MotorTraceBricktronicsShield
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example holds a motor still, and keeps a trace of the last 32 control
+// loop samples in RAM. Grab the motor and twist it: as soon as it's pushed
+// more than 30 ticks away, the trigger goes off, the motor records 16 more
+// samples, and the whole trace (what happened before and after the push) is
+// printed to the serial port, one sample per line. Paste it into a
+// spreadsheet to plot it. Then the trace starts over, ready for the next
+// push.
+//
+// Printing every sample as it happens would slow the control loop down too
+// much to see anything interesting, which is why the samples are only printed
+// once they're all recorded.
+//
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Shield
+//   https://store.wayneandlayne.com/products/bricktronics-shield-kit.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsShield library
+//   https://github.com/wayneandlayne/BricktronicsShield
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsShield.h>
+#include <BricktronicsMotor.h>
+
+
+// Select the motor port (MOTOR_1 or MOTOR_2) in the constructor below.
+BricktronicsMotor m(BricktronicsShield::MOTOR_1);
+
+// Room for 32 samples, 16 bytes each
+BricktronicsMotorTraceSample trace[32];
+
+
+void setup()
+{
+  Serial.begin(115200);
+
+  // Initialize the Bricktronics Shield
+  BricktronicsShield::begin();
+
+  // Initialize the motor connections
+  m.begin();
+
+  // Run the control loop every 5 ms, so the trace covers 160 ms
+  m.pidSetUpdateFrequencyMS(5);
+
+  // Trigger on a position error of more than 30 ticks, and keep half of the
+  // trace from after the trigger
+  m.traceBegin(trace, 32);
+  m.traceSetTrigger(BRICKTRONICS_MOTOR_TRACE_TRIGGER_ERROR, 30);
+
+  // Hold the motor where it is
+  m.goToPosition(m.getPosition());
+}
+
+void loop()
+{
+  m.update();
+
+  if( m.traceDone() )
+  {
+    m.traceDump(Serial);
+    Serial.println();
+    m.traceArm();
+  }
+}
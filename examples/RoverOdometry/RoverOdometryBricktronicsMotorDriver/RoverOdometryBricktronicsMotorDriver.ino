@@ -0,0 +1,106 @@
+// Bricktronics Example: RoverOdometryBricktronicsMotorDriver
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example shows how to drive a two-wheeled rover, with a motor on each
+// side, and keep track of where it is. The rover drives around a square,
+// printing its position and heading at each corner. If the printed heading
+// doesn't match how far the rover really turned, adjust the track width.
+//
+// This example uses a motor, so it needs more power than a USB port can give.
+// We really don't recommend running motors off of USB ports (they will be
+// slow and sluggish, other things won't quite work right, things can get hot)
+// it's just not a good idea.  Use an external power supply that provides
+// between 7.2 and 9 volts DC, and can provide at least 600 mA per motor
+// (1 amp preferably). Two options that work really well are a 9V wall adapter
+// or a 6xAA battery pack (2.1mm plug, center positive).
+//
+// Hardware used:
+// * Wayne and Layne Bricktronics Motor Driver
+//   https://store.wayneandlayne.com/products/bricktronics-motor-driver.html
+// * LEGO NXT or EV3 Motor
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+#include <BricktronicsDifferentialDrive.h>
+
+
+
+// Update the five pin assignments in the constructors below.
+// The arguments are: enPin, dirPin, pwmPin, encoderPin1, encoderPin2
+// There are a few considerations for pin assignments:
+// A. pwmPin needs to be a pin with PWM capabilities (supports analogWrite)
+//      Uno:       pins 3, 5, 6, 9, 10, and 11
+//      Mega 2560: pins 2 to 13 and 44 to 46
+// B. There are three ways to connect the encoder pins (labeled T1/T2 on the board).
+// ** Best performance: Both signals are connected to true interrupt pins (listed below).
+// ** Good performance: The FIRST signal (T1) is connected to an interrupt pin, the second signa is a regular pin. This is the mode used for the Bricktronics Shield/Megashield. For this mode it is CRITICAL that the true interrupt pin is used for T1 and not T2.
+// ** Low performance: Both signals are connected to non-interrupt pins.
+// Regardless of which performance mode used, you MUST list the pin T1 before T2 in
+//   the constructor, otherwise the encoder will be connected backwards and the
+//   PID algorithm will get all confused and freak out.
+// Location of true interrupt pins:
+//      Uno:       pins 2 and 3
+//      Mega 2560: pins 2, 3, 21, 20, 19, and 18
+//
+BricktronicsMotor left(4, 5, 10, 2, 8);
+BricktronicsMotor right(6, 7, 11, 3, 9);
+
+// The track width is the distance between the wheels, in encoder ticks of
+// wheel travel: trackWidth * 720 / (pi * wheelDiameter). With the 56 mm
+// wheels 112 mm apart, that's 458.
+BricktronicsDifferentialDrive rover(left, right, 458);
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  // Initialize the motor connections, and start at (0, 0)
+  rover.begin();
+
+  // The left motor faces the other way, so it turns backwards when the
+  // rover drives forwards.
+  rover.setReversed(true, false);
+}
+
+void printPose()
+{
+  Serial.print("x: ");
+  Serial.print(rover.getX());
+  Serial.print(" y: ");
+  Serial.print(rover.getY());
+  Serial.print(" heading: ");
+  Serial.println(rover.getHeadingDegrees());
+}
+
+void loop()
+{
+  for( int side = 0; side < 4; side++ )
+  {
+    // Drive forward at 300 ticks per second for two seconds,
+    rover.drive(300, 0);
+    rover.delayUpdateMS(2000);
+
+    // then turn left on the spot at 90 degrees per second for one second.
+    rover.drive(0, 90);
+    rover.delayUpdateMS(1000);
+
+    rover.stop();
+    rover.delayUpdateMS(500);
+    printPose();
+  }
+  delay(5000);
+}
@@ -0,0 +1,211 @@
+// Bricktronics Example: TrigBenchmark
+// http://www.wayneandlayne.com/bricktronics
+//
+// This example measures how long the integer trig functions (and the
+// two-link arm kinematics built on them) take, next to the floating-point
+// versions from the math library, and how far apart their answers are.
+//
+// This example doesn't drive any motors, it only needs an Arduino board.
+//
+// Software libraries used:
+// * Wayne and Layne BricktronicsMotor library
+//   https://github.com/wayneandlayne/BricktronicsMotor
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+//   with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>. 
+
+
+// Include the Bricktronics libraries
+#include <BricktronicsMotor.h>
+// The integer trig and the arm kinematics come with the motor group
+#include <BricktronicsMotorGroup.h>
+
+
+// How many calls to time for each function
+#define RUNS 500
+
+// An arm with links 120.0 and 90.0 mm long (in tenths of a millimeter)
+#define LENGTH1 1200
+#define LENGTH2 900
+BricktronicsTwoLinkArm arm(LENGTH1, LENGTH2, 720, 720);
+
+// The results go here, so the compiler can't leave the calls out
+volatile int16_t integerResult;
+volatile double floatResult;
+
+// The time it takes to call micros() twice, to subtract from the results
+unsigned long overhead;
+
+
+void setup()
+{
+  // Be sure to set your serial console to 115200 baud
+  Serial.begin(115200);
+
+  unsigned long start = micros();
+  overhead = micros() - start;
+}
+
+// A binary angle, and the same angle in radians
+uint16_t testAngle(int i)
+{
+  return i * 131;
+}
+double testRadians(int i)
+{
+  return testAngle(i) * ( 2 * PI / 65536 );
+}
+
+// A point the arm can reach
+int32_t testX(int i)
+{
+  return 400 + ( i * 7 ) % 1400;
+}
+int32_t testY(int i)
+{
+  return -800 + ( i * 13 ) % 1600;
+}
+
+// Inverse kinematics in floating point, the way a sketch would usually do it
+void floatInverse(double x, double y, double *angle1, double *angle2)
+{
+  double c = ( x * x + y * y - (double) LENGTH1 * LENGTH1 - (double) LENGTH2 * LENGTH2 ) / ( 2.0 * LENGTH1 * LENGTH2 );
+  *angle2 = atan2(sqrt(1 - c * c), c);
+  *angle1 = atan2(y, x) - atan2(LENGTH2 * sin(*angle2), LENGTH1 + LENGTH2 * cos(*angle2));
+}
+
+// Print the average time per call, and the approximate number of cycles
+void printResult(const char *name, unsigned long total)
+{
+  float us = (float) total / RUNS;
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(us);
+  Serial.print(" us, about ");
+  Serial.print((unsigned long) (us * (F_CPU / 1000000UL)));
+  Serial.println(" cycles");
+}
+
+void loop()
+{
+  unsigned long start, total;
+  Serial.println("");
+  Serial.println("Average time per call (micros() counts in 4 us steps on 16 MHz boards):");
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    double radians = testRadians(i);
+    start = micros();
+    floatResult = sin(radians);
+    total += micros() - start - overhead;
+  }
+  printResult("sin() (floating point)", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    uint16_t angle = testAngle(i);
+    start = micros();
+    integerResult = BricktronicsTrig::sine(angle);
+    total += micros() - start - overhead;
+  }
+  printResult("BricktronicsTrig::sine()", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    double x = testX(i), y = testY(i);
+    start = micros();
+    floatResult = atan2(y, x);
+    total += micros() - start - overhead;
+  }
+  printResult("atan2() (floating point)", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    int32_t x = testX(i), y = testY(i);
+    start = micros();
+    integerResult = BricktronicsTrig::arctan2(y, x);
+    total += micros() - start - overhead;
+  }
+  printResult("BricktronicsTrig::arctan2()", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    uint32_t value = (uint32_t) testX(i) * testY(i + 100);
+    double floatValue = value;
+    start = micros();
+    floatResult = sqrt(floatValue);
+    total += micros() - start - overhead;
+  }
+  printResult("sqrt() (floating point)", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    uint32_t value = (uint32_t) testX(i) * testY(i + 100);
+    start = micros();
+    integerResult = BricktronicsTrig::squareRoot(value);
+    total += micros() - start - overhead;
+  }
+  printResult("BricktronicsTrig::squareRoot()", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    double x = testX(i), y = testY(i), angle1, angle2;
+    start = micros();
+    floatInverse(x, y, &angle1, &angle2);
+    total += micros() - start - overhead;
+    floatResult = angle1 + angle2;
+  }
+  printResult("Arm inverse kinematics (floating point)", total);
+
+  total = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    int32_t x = testX(i), y = testY(i);
+    uint16_t angle1, angle2;
+    start = micros();
+    arm.inverseAngles(x, y, &angle1, &angle2);
+    total += micros() - start - overhead;
+    integerResult = angle1 + angle2;
+  }
+  printResult("Arm inverse kinematics (integer)", total);
+
+  // How far apart the answers are, in the units of the integer versions
+  Serial.println("Largest differences:");
+  double sineError = 0, arctanError = 0, armError = 0;
+  for (int i = 0; i < RUNS; i++)
+  {
+    double error = fabs(BricktronicsTrig::sine(testAngle(i)) - 32767 * sin(testRadians(i)));
+    sineError = max(sineError, error);
+
+    // Angles wrap around, so look at the difference as a binary angle
+    int32_t x = testX(i), y = testY(i);
+    int16_t angleError = BricktronicsTrig::arctan2(y, x) - (int16_t) lround(atan2(y, x) * 32768 / PI);
+    arctanError = max(arctanError, fabs(angleError));
+
+    // Where the integer joint angles put the end of the arm
+    uint16_t angle1, angle2;
+    int32_t armX, armY;
+    arm.inverseAngles(x, y, &angle1, &angle2);
+    arm.forwardAngles(angle1, angle2, &armX, &armY);
+    armError = max(armError, fabs(armX - x) + fabs(armY - y));
+  }
+  Serial.print("sine (out of 32767): ");
+  Serial.println(sineError);
+  Serial.print("arctan2 (65536 per turn): ");
+  Serial.println(arctanError);
+  Serial.print("Arm forward(inverse(x, y)) (tenths of a mm): ");
+  Serial.println(armError);
+
+  delay(5000);
+}
@@ -0,0 +1,692 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSCLIENT_H
+#define BRICKTRONICSCLIENT_H
+
+// A client for the binary motor command protocol (see
+// BricktronicsMotorProtocol.h), for a Linux computer driving one or more
+// Arduinos. This isn't part of the Arduino library itself, it's for the
+// computer on the other end of the USB cable. It needs C++11 and threads:
+//
+//   g++ -std=c++11 -pthread yourprogram.cpp
+//
+// Commands never wait for the Arduino. Each one goes out right away if
+// there's room in the Arduino's queue (as of its last reply), or waits in the
+// client's own queue until there is, and you get a std::future for its reply.
+// A reader thread in the background takes in the replies, sends waiting
+// commands as room opens up, and sends again from wherever a frame went
+// missing (or the Arduino's queue was full). Frames from the Arduino that
+// aren't replies (telemetry) go into a lock-free queue, for readTelemetry().
+//
+// Use one client for each Arduino.
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../utility/BricktronicsProtocol.h"
+
+// How many telemetry frames can wait for readTelemetry(), a power of two
+#define BRICKTRONICS_CLIENT_TELEMETRY_SIZE                  1024
+
+// Commands are sent again if they aren't answered in this long
+#define BRICKTRONICS_CLIENT_RETRY_MS                        100
+
+// After the Arduino's queue was full, wait this long before trying again
+#define BRICKTRONICS_CLIENT_FULL_WAIT_MS                    2
+
+// The most frames on their way at once (less than half the sequence numbers)
+#define BRICKTRONICS_CLIENT_MAX_IN_FLIGHT                   64
+
+// The status of replies that will never come, because the client was closed
+// or reconnected
+#define BRICKTRONICS_CLIENT_CLOSED                          0xFF
+
+// A reply from the Arduino. The payload is what comes after the status and
+// room, see utility/BricktronicsProtocol.h.
+typedef struct BricktronicsClientReply
+{
+   uint8_t status;
+   uint8_t room;
+   uint8_t length;
+   uint8_t payload[BRICKTRONICS_PROTOCOL_MAX_PAYLOAD];
+} BricktronicsClientReply;
+
+// A frame from the Arduino that isn't a reply, with when it arrived (in
+// microseconds, from the client's steady clock)
+typedef struct BricktronicsClientFrame
+{
+   uint64_t timeUS;
+   uint8_t sequence;
+   uint8_t command;
+   uint8_t length;
+   uint8_t payload[BRICKTRONICS_PROTOCOL_MAX_PAYLOAD];
+} BricktronicsClientFrame;
+
+// One motor, from the reply to status()
+typedef struct BricktronicsClientMotorStatus
+{
+   int32_t position;
+   int16_t speed;
+   uint8_t mode;
+} BricktronicsClientMotorStatus;
+
+// A motor's control loop sample, from a telemetry frame (see
+// BricktronicsMotorTelemetry.h)
+typedef struct BricktronicsClientTelemetry
+{
+   uint8_t motor;
+   uint32_t timeUS;
+   int32_t setpoint;
+   int32_t position;
+   int16_t output;
+   uint8_t mode;
+   uint8_t flags;
+} BricktronicsClientTelemetry;
+
+class BricktronicsClient
+{
+    public:
+        BricktronicsClient():
+            _fd(-1),
+            _running(false),
+            _telemetry(BRICKTRONICS_CLIENT_TELEMETRY_SIZE),
+            _telemetryHead(0),
+            _telemetryTail(0),
+            _telemetryDropped(0),
+            _sequence(0),
+            _room(1),
+            _batching(false),
+            _retries(0)
+        {
+        }
+
+        ~BricktronicsClient()
+        {
+            close();
+        }
+
+        // Opens a serial port (like "/dev/ttyACM0") at baud, and starts the
+        // reader thread. Most Arduinos restart when the port is opened, so
+        // connect() keeps trying for a while. Returns false if it couldn't.
+        bool openSerial(const char *device, uint32_t baud)
+        {
+            speed_t speed = _speed(baud);
+            int fd = ::open(device, O_RDWR | O_NOCTTY);
+            if( fd < 0 )
+            {
+                return false;
+            }
+            struct termios options;
+            if( speed == 0 || tcgetattr(fd, &options) != 0 )
+            {
+                ::close(fd);
+                return false;
+            }
+            cfmakeraw(&options);
+            cfsetispeed(&options, speed);
+            cfsetospeed(&options, speed);
+            options.c_cflag |= CLOCAL | CREAD;
+            options.c_cc[VMIN] = 0;
+            options.c_cc[VTIME] = 0;
+            if( tcsetattr(fd, TCSANOW, &options) != 0 )
+            {
+                ::close(fd);
+                return false;
+            }
+            tcflush(fd, TCIOFLUSH);
+            return attach(fd);
+        }
+
+        // Uses a file descriptor that's already open (a pty, a socket, one
+        // end of a pipe...), and starts the reader thread. The client closes
+        // it when it's done.
+        bool attach(int fd)
+        {
+            close();
+            _fd = fd;
+            _running = true;
+            _reader = std::thread(&BricktronicsClient::_read, this);
+            return true;
+        }
+
+        // Stops the reader thread and closes the port. Replies that haven't
+        // come yet get the status BRICKTRONICS_CLIENT_CLOSED.
+        void close(void)
+        {
+            if( _fd < 0 )
+            {
+                return;
+            }
+            _running = false;
+            _reader.join();
+            ::close(_fd);
+            _fd = -1;
+            std::lock_guard<std::mutex> lock(_lock);
+            _clear();
+        }
+
+        // Pings the Arduino, which starts the sequence numbers over, and
+        // forgets about any commands that haven't been answered. Keeps trying
+        // for up to timeoutMS. Returns the number of motors, or -1 if there
+        // was no answer.
+        int connect(uint32_t timeoutMS = 3000)
+        {
+            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMS);
+            while( std::chrono::steady_clock::now() < end )
+            {
+                std::future<BricktronicsClientReply> reply;
+                {
+                    std::lock_guard<std::mutex> lock(_lock);
+                    _clear();
+                    _sequence = 0;
+                    _room = 1;
+                    reply = _queue(BRICKTRONICS_PROTOCOL_PING, NULL, 0);
+                    _pump(std::chrono::steady_clock::now());
+                }
+                if( reply.wait_for(std::chrono::milliseconds(250)) == std::future_status::ready )
+                {
+                    BricktronicsClientReply r = reply.get();
+                    if( r.status == BRICKTRONICS_PROTOCOL_OK && r.length >= 2 )
+                    {
+                        return r.payload[1];
+                    }
+                }
+            }
+            return -1;
+        }
+
+        // Sends any command (see utility/BricktronicsProtocol.h). The
+        // future is ready once the Arduino has answered: for queued commands,
+        // that's when the command is in the queue, not when it's done.
+        std::future<BricktronicsClientReply> send(uint8_t command, const uint8_t *payload, uint8_t length)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            std::future<BricktronicsClientReply> reply = _queue(command, payload, length);
+            _pump(std::chrono::steady_clock::now());
+            return reply;
+        }
+
+        // Moves all the motors in mask at once, to a position each, in one
+        // frame. The next command starts after durationMS, or once they've
+        // all settled if it's 0. A mask with more than 6 motors isn't sent,
+        // and gets BRICKTRONICS_PROTOCOL_BAD_COMMAND right away.
+        std::future<BricktronicsClientReply> move(uint8_t mask, const int32_t *positions, uint16_t durationMS)
+        {
+            uint8_t payload[BRICKTRONICS_PROTOCOL_MAX_COMMAND];
+            uint8_t motors = BricktronicsProtocol::countMotors(mask);
+            if( motors > BRICKTRONICS_PROTOCOL_MAX_MOTORS )
+            {
+                return _badCommand();
+            }
+            payload[0] = mask;
+            BricktronicsProtocol::putInt16(payload + 1, durationMS);
+            for( uint8_t i = 0; i < motors; i++ )
+            {
+                BricktronicsProtocol::putInt32(payload + 3 + 4 * i, positions[i]);
+            }
+            return send(BRICKTRONICS_PROTOCOL_MOVE, payload, 3 + 4 * motors);
+        }
+
+        // Sets the speeds (ticks per second) of all the motors in mask, in
+        // one frame. Like move(), up to 6 motors.
+        std::future<BricktronicsClientReply> setSpeeds(uint8_t mask, const int16_t *speeds)
+        {
+            uint8_t payload[BRICKTRONICS_PROTOCOL_MAX_COMMAND];
+            uint8_t motors = BricktronicsProtocol::countMotors(mask);
+            if( motors > BRICKTRONICS_PROTOCOL_MAX_MOTORS )
+            {
+                return _badCommand();
+            }
+            payload[0] = mask;
+            for( uint8_t i = 0; i < motors; i++ )
+            {
+                BricktronicsProtocol::putInt16(payload + 1 + 2 * i, speeds[i]);
+            }
+            return send(BRICKTRONICS_PROTOCOL_SPEED, payload, 1 + 2 * motors);
+        }
+
+        // A line or an arc for the Arduino's motor group
+        std::future<BricktronicsClientReply> line(int32_t x, int32_t y, uint16_t speed)
+        {
+            uint8_t payload[10];
+            BricktronicsProtocol::putInt32(payload, x);
+            BricktronicsProtocol::putInt32(payload + 4, y);
+            BricktronicsProtocol::putInt16(payload + 8, speed);
+            return send(BRICKTRONICS_PROTOCOL_LINE, payload, 10);
+        }
+        std::future<BricktronicsClientReply> arc(int32_t centerX, int32_t centerY, int16_t degrees, uint16_t speed)
+        {
+            uint8_t payload[12];
+            BricktronicsProtocol::putInt32(payload, centerX);
+            BricktronicsProtocol::putInt32(payload + 4, centerY);
+            BricktronicsProtocol::putInt16(payload + 8, degrees);
+            BricktronicsProtocol::putInt16(payload + 10, speed);
+            return send(BRICKTRONICS_PROTOCOL_ARC, payload, 12);
+        }
+
+        // Asks where the motors in mask are, see getStatus()
+        std::future<BricktronicsClientReply> status(uint8_t mask)
+        {
+            return send(BRICKTRONICS_PROTOCOL_STATUS, &mask, 1);
+        }
+
+        // Empties the Arduino's queue, and holds the motors in mask where
+        // they are. This still waits behind commands that haven't been sent
+        // yet.
+        std::future<BricktronicsClientReply> stop(uint8_t mask)
+        {
+            return send(BRICKTRONICS_PROTOCOL_STOP, &mask, 1);
+        }
+
+        // Pulls the motors out of a reply to status(). Returns whether the
+        // Arduino's queue was busy, and fills in up to count motors. If the
+        // reply isn't a good one (check its status), nothing is filled in
+        // and this returns false.
+        static bool getStatus(const BricktronicsClientReply &reply, BricktronicsClientMotorStatus *motors, uint8_t count)
+        {
+            if( reply.status != BRICKTRONICS_PROTOCOL_OK )
+            {
+                return false;
+            }
+            for( uint8_t i = 0; i < count && 1 + 7 * i + 7 <= reply.length; i++ )
+            {
+                const uint8_t *motor = reply.payload + 1 + 7 * i;
+                motors[i].position = BricktronicsProtocol::getInt32(motor);
+                motors[i].speed = BricktronicsProtocol::getInt16(motor + 4);
+                motors[i].mode = motor[6];
+            }
+            return reply.length > 0 && reply.payload[0];
+        }
+
+        // Pulls a motor's sample out of a telemetry frame. Returns false if
+        // it's some other frame. The frames' sequence numbers count up by one
+        // for each sample, including the ones the Arduino had to drop.
+        static bool getTelemetry(const BricktronicsClientFrame &frame, BricktronicsClientTelemetry *telemetry)
+        {
+            if( frame.command != BRICKTRONICS_PROTOCOL_TELEMETRY || frame.length < BRICKTRONICS_PROTOCOL_TELEMETRY_SIZE )
+            {
+                return false;
+            }
+            telemetry->motor = frame.payload[0];
+            telemetry->timeUS = BricktronicsProtocol::getInt32(frame.payload + 1);
+            telemetry->setpoint = BricktronicsProtocol::getInt32(frame.payload + 5);
+            telemetry->position = BricktronicsProtocol::getInt32(frame.payload + 9);
+            telemetry->output = BricktronicsProtocol::getInt16(frame.payload + 13);
+            telemetry->mode = frame.payload[15];
+            telemetry->flags = frame.payload[16];
+            return true;
+        }
+
+        // Commands sent between these go out in a single write, as soon as
+        // there's room for them.
+        void beginBatch(void)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _batching = true;
+        }
+        void endBatch(void)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _batching = false;
+            _pump(std::chrono::steady_clock::now());
+        }
+
+        // Waits (up to timeoutMS) until every command has been answered.
+        // Returns false if some haven't.
+        bool waitForReplies(uint32_t timeoutMS)
+        {
+            std::unique_lock<std::mutex> lock(_lock);
+            return _answered.wait_for(lock, std::chrono::milliseconds(timeoutMS), [this] { return _waiting.empty() && _inFlight.empty(); });
+        }
+
+        // The number of commands that haven't been answered yet
+        size_t getPending(void)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            return _waiting.size() + _inFlight.size();
+        }
+
+        // Takes the oldest telemetry frame. Returns false if there isn't one.
+        // Only call this from one thread.
+        bool readTelemetry(BricktronicsClientFrame *frame)
+        {
+            uint32_t tail = _telemetryTail.load(std::memory_order_relaxed);
+            if( tail == _telemetryHead.load(std::memory_order_acquire) )
+            {
+                return false;
+            }
+            *frame = _telemetry[tail & ( BRICKTRONICS_CLIENT_TELEMETRY_SIZE - 1 )];
+            _telemetryTail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // How many telemetry frames were dropped because the queue was full
+        uint32_t getTelemetryDropped(void)
+        {
+            return _telemetryDropped;
+        }
+
+        // How many frames from the Arduino were dropped for a bad CRC or
+        // length. Only read this from the reader thread, or once it's closed.
+        uint16_t getFrameErrors(void)
+        {
+            return _decoder.getErrors();
+        }
+
+        // How many times commands had to be sent again, because a frame or
+        // a reply was lost
+        uint32_t getRetries(void)
+        {
+            return _retries;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        struct Command
+        {
+            uint8_t command;
+            uint8_t length;
+            uint8_t sequence;
+            uint8_t payload[BRICKTRONICS_PROTOCOL_MAX_PAYLOAD];
+            std::chrono::steady_clock::time_point sentAt;
+            std::promise<BricktronicsClientReply> reply;
+        };
+
+        int _fd;
+        std::atomic<bool> _running;
+        std::thread _reader;
+        BricktronicsFrameDecoder _decoder;
+
+        // Telemetry, in a single producer (the reader thread), single
+        // consumer ring
+        std::vector<BricktronicsClientFrame> _telemetry;
+        std::atomic<uint32_t> _telemetryHead, _telemetryTail;
+        std::atomic<uint32_t> _telemetryDropped;
+
+        // Everything below is guarded by _lock. Commands wait in _waiting
+        // until there's room, and then in _inFlight (in sequence number
+        // order) until they're answered.
+        std::mutex _lock;
+        std::condition_variable _answered;
+        std::deque<Command> _waiting;
+        std::deque<Command> _inFlight;
+        uint8_t _sequence;
+        uint8_t _room;
+        std::chrono::steady_clock::time_point _fullUntil;
+        bool _batching;
+        std::vector<uint8_t> _output;
+        std::atomic<uint32_t> _retries;
+
+        std::future<BricktronicsClientReply> _queue(uint8_t command, const uint8_t *payload, uint8_t length)
+        {
+            _waiting.push_back(Command());
+            Command &c = _waiting.back();
+            c.command = command;
+            c.length = length > BRICKTRONICS_PROTOCOL_MAX_PAYLOAD ? BRICKTRONICS_PROTOCOL_MAX_PAYLOAD : length;
+            if( c.length > 0 )
+            {
+                memcpy(c.payload, payload, c.length);
+            }
+            return c.reply.get_future();
+        }
+
+        // Sends waiting commands while there's room, and writes them out
+        // (unless batching)
+        void _pump(std::chrono::steady_clock::time_point now)
+        {
+            size_t window = _room > 0 ? _room : 1;
+            if( window > BRICKTRONICS_CLIENT_MAX_IN_FLIGHT )
+            {
+                window = BRICKTRONICS_CLIENT_MAX_IN_FLIGHT;
+            }
+            while( !_waiting.empty() && _inFlight.size() < window && now >= _fullUntil )
+            {
+                _inFlight.push_back(std::move(_waiting.front()));
+                _waiting.pop_front();
+                Command &c = _inFlight.back();
+                c.sequence = _sequence++;
+                c.sentAt = now;
+                size_t end = _output.size();
+                _output.resize(end + c.length + BRICKTRONICS_PROTOCOL_OVERHEAD);
+                BricktronicsProtocol::encode(&_output[end], c.sequence, c.command, c.payload, c.length);
+            }
+            if( _batching || _output.empty() )
+            {
+                return;
+            }
+            size_t written = 0;
+            while( written < _output.size() )
+            {
+                ssize_t n = ::write(_fd, &_output[written], _output.size() - written);
+                if( n < 0 && ( errno == EAGAIN || errno == EINTR ) )
+                {
+                    struct pollfd p = { _fd, POLLOUT, 0 };
+                    poll(&p, 1, 10);
+                    continue;
+                }
+                if( n <= 0 )
+                {
+                    // The port is gone. Retries will come to nothing, and
+                    // close() answers everything.
+                    break;
+                }
+                written += n;
+            }
+            _output.clear();
+        }
+
+        // Answers the first count commands in flight
+        void _answer(size_t count, const BricktronicsClientReply &reply)
+        {
+            for( size_t i = 0; i < count && !_inFlight.empty(); i++ )
+            {
+                _inFlight.front().reply.set_value(reply);
+                _inFlight.pop_front();
+            }
+            _answered.notify_all();
+        }
+
+        // Sends everything in flight again, from the start
+        void _resend(void)
+        {
+            _sequence = _inFlight.front().sequence;
+            while( !_inFlight.empty() )
+            {
+                _waiting.push_front(std::move(_inFlight.back()));
+                _inFlight.pop_back();
+            }
+        }
+
+        // A reply for a command that can't be sent, like the Arduino would
+        // give it
+        std::future<BricktronicsClientReply> _badCommand(void)
+        {
+            BricktronicsClientReply bad;
+            memset(&bad, 0, sizeof(bad));
+            bad.status = BRICKTRONICS_PROTOCOL_BAD_COMMAND;
+            std::promise<BricktronicsClientReply> reply;
+            reply.set_value(bad);
+            return reply.get_future();
+        }
+
+        void _clear(void)
+        {
+            BricktronicsClientReply closed;
+            memset(&closed, 0, sizeof(closed));
+            closed.status = BRICKTRONICS_CLIENT_CLOSED;
+            _answer(_inFlight.size(), closed);
+            while( !_waiting.empty() )
+            {
+                _waiting.front().reply.set_value(closed);
+                _waiting.pop_front();
+            }
+            _output.clear();
+            _answered.notify_all();
+        }
+
+        void _handleReply(void)
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            if( _inFlight.empty() || _decoder.getLength() < 2 )
+            {
+                return;
+            }
+            BricktronicsClientReply reply;
+            reply.status = _decoder.getPayload()[0];
+            reply.room = _decoder.getPayload()[1];
+            reply.length = _decoder.getLength() - 2;
+            memcpy(reply.payload, _decoder.getPayload() + 2, reply.length);
+
+            // Which command in flight this answers. The Arduino takes frames
+            // in order, so the ones before it got there, even if their replies
+            // were lost.
+            size_t index = (uint8_t) ( _decoder.getSequence() - _inFlight.front().sequence );
+            if( index >= _inFlight.size() || _inFlight[index].command != ( _decoder.getCommand() & ~BRICKTRONICS_PROTOCOL_REPLY ) )
+            {
+                return;
+            }
+            BricktronicsClientReply lost = reply;
+            lost.status = BRICKTRONICS_PROTOCOL_DUPLICATE;
+            lost.length = 0;
+            _room = reply.room;
+            switch( reply.status )
+            {
+                case BRICKTRONICS_PROTOCOL_QUEUE_FULL:
+                    // The Arduino drops the ones after it, so send them again
+                    // after a little while
+                    _answer(index, lost);
+                    _resend();
+                    _fullUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(BRICKTRONICS_CLIENT_FULL_WAIT_MS);
+                    break;
+                case BRICKTRONICS_PROTOCOL_OUT_OF_SEQUENCE:
+                {
+                    // Everything before the one it expected got there
+                    size_t expected = reply.length > 0 ? (uint8_t) ( reply.payload[0] - _inFlight.front().sequence ) : 0;
+                    _answer(expected < index ? expected : index, lost);
+                    _resend();
+                    _retries++;
+                    break;
+                }
+                default:
+                    _answer(index, lost);
+                    _answer(1, reply);
+                    break;
+            }
+            _pump(std::chrono::steady_clock::now());
+        }
+
+        void _handleTelemetry(void)
+        {
+            uint32_t head = _telemetryHead.load(std::memory_order_relaxed);
+            if( head - _telemetryTail.load(std::memory_order_acquire) >= BRICKTRONICS_CLIENT_TELEMETRY_SIZE )
+            {
+                _telemetryDropped++;
+                return;
+            }
+            BricktronicsClientFrame &frame = _telemetry[head & ( BRICKTRONICS_CLIENT_TELEMETRY_SIZE - 1 )];
+            frame.timeUS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            frame.sequence = _decoder.getSequence();
+            frame.command = _decoder.getCommand();
+            frame.length = _decoder.getLength();
+            memcpy(frame.payload, _decoder.getPayload(), frame.length);
+            _telemetryHead.store(head + 1, std::memory_order_release);
+        }
+
+        // The reader thread
+        void _read(void)
+        {
+            uint8_t buffer[256];
+            while( _running )
+            {
+                struct pollfd p = { _fd, POLLIN, 0 };
+                if( poll(&p, 1, 1) > 0 )
+                {
+                    ssize_t n = ::read(_fd, buffer, sizeof(buffer));
+                    for( ssize_t i = 0; i < n; i++ )
+                    {
+                        if( !_decoder.decode(buffer[i]) )
+                        {
+                            continue;
+                        }
+                        if( _decoder.getCommand() & BRICKTRONICS_PROTOCOL_REPLY )
+                        {
+                            _handleReply();
+                        }
+                        else
+                        {
+                            _handleTelemetry();
+                        }
+                    }
+                }
+                std::lock_guard<std::mutex> lock(_lock);
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if( !_inFlight.empty() && now - _inFlight.front().sentAt > std::chrono::milliseconds(BRICKTRONICS_CLIENT_RETRY_MS) )
+                {
+                    _resend();
+                    _retries++;
+                }
+                _pump(now);
+            }
+        }
+
+        static speed_t _speed(uint32_t baud)
+        {
+            switch( baud )
+            {
+                case 9600: return B9600;
+                case 19200: return B19200;
+                case 38400: return B38400;
+                case 57600: return B57600;
+                case 115200: return B115200;
+                case 230400: return B230400;
+                case 460800: return B460800;
+                case 500000: return B500000;
+                case 1000000: return B1000000;
+                case 2000000: return B2000000;
+                default: return 0;
+            }
+        }
+};
+
+#endif // #ifndef BRICKTRONICSCLIENT_H
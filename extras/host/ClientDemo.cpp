@@ -0,0 +1,83 @@
+// Bricktronics host client demo
+// http://www.wayneandlayne.com/bricktronics
+//
+// Drives two motors on an Arduino running the MotorSerialProtocol example,
+// from a Linux computer. It streams a circle of 2 ms moves (for both motors
+// at once) to the Arduino as fast as its queue takes them, and then asks
+// where the motors ended up.
+//
+// Build and run it with:
+//
+//   g++ -std=c++11 -pthread ClientDemo.cpp -o ClientDemo
+//   ./ClientDemo /dev/ttyACM0 115200
+//
+// Written in 2016 by Matthew Beckler and Adam Wolf for Wayne and Layne, LLC
+// To the extent possible under law, the author(s) have dedicated all
+//   copyright and related and neighboring rights to this software to the
+//   public domain worldwide. This software is distributed without any warranty.
+// You should have received a copy of the CC0 Public Domain Dedication along
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BricktronicsClient.h"
+
+int main(int argc, char **argv)
+{
+    if( argc < 3 )
+    {
+        printf("Usage: %s /dev/ttyACM0 115200\n", argv[0]);
+        return 1;
+    }
+
+    BricktronicsClient client;
+    if( !client.openSerial(argv[1], atoi(argv[2])) )
+    {
+        printf("Couldn't open %s\n", argv[1]);
+        return 1;
+    }
+    int motors = client.connect();
+    if( motors < 2 )
+    {
+        printf("No answer from the Arduino\n");
+        return 1;
+    }
+    printf("Connected, %d motors\n", motors);
+
+    // Each batch of moves goes out in a single write
+    for( int i = 0; i < 1000; i += 10 )
+    {
+        client.beginBatch();
+        for( int j = i; j < i + 10; j++ )
+        {
+            int32_t positions[2] = { (int32_t) lround(300 * sin(j * 0.00628)), (int32_t) lround(300 * cos(j * 0.00628) - 300) };
+            client.move(0x03, positions, 2);
+        }
+        client.endBatch();
+    }
+    if( !client.waitForReplies(10000) )
+    {
+        printf("The Arduino stopped answering\n");
+        return 1;
+    }
+
+    // Wait for the queue to finish, then see where the motors are
+    BricktronicsClientMotorStatus status[2] = {};
+    while( true )
+    {
+        BricktronicsClientReply reply = client.status(0x03).get();
+        if( reply.status != BRICKTRONICS_PROTOCOL_OK )
+        {
+            printf("The Arduino stopped answering\n");
+            return 1;
+        }
+        if( !BricktronicsClient::getStatus(reply, status, 2) )
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    printf("Done at %d, %d, after %u retries\n", status[0].position, status[1].position, client.getRetries());
+    return 0;
+}
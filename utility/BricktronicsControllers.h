@@ -0,0 +1,565 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSCONTROLLERS_H
+#define BRICKTRONICSCONTROLLERS_H
+
+// Alternative position controllers for BricktronicsControlledMotor.
+//
+// A controller is picked at compile time with the template parameter, so
+// the controllers you don't use take no flash or RAM. Every controller has
+// the same interface as the PID library (the default controller), so the
+// motor can call it without knowing which one it is:
+//
+//   Controller(double *input, double *output, double *setpoint)
+//   void SetMode(int Mode)                  AUTOMATIC or MANUAL
+//   bool Compute(void)                      true when a new output was computed
+//   void SetOutputLimits(double Min, double Max)
+//   void SetSampleTime(int NewSampleTime)   in milliseconds
+//   void SetTunings(double, double, double)
+//   void SetScaledTunings(double, double, double)
+//   void ScheduleTunings(double, double, double)
+//   double GetKp(void), GetKi(void), GetKd(void)
+//   double GetITerm(void)                   the integral term, in output units
+//   static const bool PIDTunings            true if the tunings are Kp, Ki, Kd
+//
+// The meaning of the three tuning parameters depends on the controller,
+// see the comments for each one below. The motor's pidSetTunings() passes
+// them to SetTunings() unchanged, and gain schedules pass them to
+// ScheduleTunings(), which takes the same tunings but gets called every
+// sample, so it does any sample time scaling the controller needs without
+// dividing. Cascaded control needs a controller with PIDTunings, since it
+// runs the outer position loop as a PI loop with the cascade tunings.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "utility/PID_v1.h"
+
+// Default tunings for the state-feedback controller: position gain (drive
+// strength per tick), speed gain (drive strength per tick per second) and
+// integral gain (drive strength per tick-second).
+#define BRICKTRONICS_STATE_FEEDBACK_KPOS                    4.0
+#define BRICKTRONICS_STATE_FEEDBACK_KVEL                    0.12
+#define BRICKTRONICS_STATE_FEEDBACK_KI                      10.0
+
+// Default tunings for the sliding mode controller: the slope of the sliding
+// surface (per second), the drive strength used to reach it, and the width
+// of the boundary layer (ticks per second) that smooths out the chattering.
+#define BRICKTRONICS_SLIDING_MODE_LAMBDA                    5.0
+#define BRICKTRONICS_SLIDING_MODE_GAIN                      255
+#define BRICKTRONICS_SLIDING_MODE_BOUNDARY                  400
+
+// Default tunings for the bang-bang controller: the drive strength, and the
+// deadband (ticks) around the setpoint where the motor is left alone.
+#define BRICKTRONICS_BANG_BANG_DRIVE                        80
+#define BRICKTRONICS_BANG_BANG_DEADBAND                     6
+
+#define BRICKTRONICS_CONTROLLER_SAMPLE_TIME_MS              50
+
+
+// The bookkeeping shared by all the controllers below: the linked variables,
+// the output limits, automatic/manual mode, and deciding when it's time to
+// compute a new output (same rules as the PID library). There are no virtual
+// functions here, each controller has its own Compute().
+class BricktronicsControllerBase
+{
+    public:
+        BricktronicsControllerBase(double *input, double *output, double *setpoint):
+            _input(input),
+            _output(output),
+            _setpoint(setpoint),
+            _sampleTime(BRICKTRONICS_CONTROLLER_SAMPLE_TIME_MS),
+            _outMin(0),
+            _outMax(255),
+            _inAuto(false),
+            _restart(true)
+        {
+            _lastTime = millis() - _sampleTime;
+        }
+
+        void SetMode(int Mode)
+        {
+            bool newAuto = ( Mode == AUTOMATIC );
+            if( newAuto && !_inAuto )
+            {
+                // Just went from manual to auto, forget the old state
+                _restart = true;
+            }
+            _inAuto = newAuto;
+        }
+
+        void SetOutputLimits(double Min, double Max)
+        {
+            if( Min >= Max )
+            {
+                return;
+            }
+            _outMin = Min;
+            _outMax = Max;
+        }
+
+        void SetSampleTime(int NewSampleTime)
+        {
+            if( NewSampleTime > 0 )
+            {
+                _sampleTime = NewSampleTime;
+            }
+        }
+
+        // Controllers without an integral term don't have anything to report.
+        double GetITerm(void)
+        {
+            return 0;
+        }
+
+    protected:
+        // Returns true (and starts the next sample period) if it's time for
+        // a new output.
+        bool _due(void)
+        {
+            if( !_inAuto )
+            {
+                return false;
+            }
+            unsigned long now = millis();
+            if( now - _lastTime < _sampleTime )
+            {
+                return false;
+            }
+            _lastTime = now;
+            return true;
+        }
+
+        double _limit(double value)
+        {
+            if( value > _outMax )
+            {
+                return _outMax;
+            }
+            if( value < _outMin )
+            {
+                return _outMin;
+            }
+            return value;
+        }
+
+        double *_input;
+        double *_output;
+        double *_setpoint;
+        unsigned long _lastTime;
+        unsigned long _sampleTime;
+        double _outMin, _outMax;
+        bool _inAuto;
+        // Set when the controller should throw away its state (integral,
+        // last input) on the next Compute(), for a bumpless start.
+        bool _restart;
+};
+
+
+// PID using only integer math, which is a lot faster than the floating-point
+// PID library on boards without an FPU (like the AVR boards).
+// Tunings: Kp, Ki, Kd, same units as the PID library.
+// The gains are stored in fixed point, Kp and Kd (divided by the sample time)
+// with 8 fractional bits (up to 127), and Ki (times the sample time) with 12
+// fractional bits (up to 7.99). The error used for the P and I terms is
+// limited to +/- 4095 ticks, where the output would be saturated anyway.
+class BricktronicsFixedPointPIDController : public BricktronicsControllerBase
+{
+    public:
+        static const bool PIDTunings = true;
+
+        BricktronicsFixedPointPIDController(double *input, double *output, double *setpoint):
+            BricktronicsControllerBase(input, output, setpoint),
+            _iTerm(0),
+            _lastInput(0)
+        {
+            SetTunings(BRICKTRONICS_MOTOR_PID_KP, BRICKTRONICS_MOTOR_PID_KI, BRICKTRONICS_MOTOR_PID_KD);
+        }
+
+        bool Compute(void)
+        {
+            if( !_due() )
+            {
+                return false;
+            }
+            int32_t input = *_input;
+            int32_t outMax = (int32_t) _outMax << 12;
+            int32_t outMin = (int32_t) _outMin << 12;
+            if( _restart )
+            {
+                _iTerm = constrain( (int32_t) ( *_output * 4096 ), outMin, outMax );
+                _lastInput = input;
+                _restart = false;
+            }
+
+            int16_t error = constrain( (int32_t) *_setpoint - input, (int32_t) -4095, (int32_t) 4095 );
+            int16_t dInput = constrain( input - _lastInput, (int32_t) -4095, (int32_t) 4095 );
+            _lastInput = input;
+
+            // The I term is in 12 fractional bits
+            _iTerm += (int32_t) _ki * error;
+            _iTerm = constrain( _iTerm, outMin, outMax );
+
+            // The P and D terms are in 8 fractional bits. Anything over 2^16
+            // saturates the output anyway, and limiting it here keeps the
+            // shift to 12 fractional bits from overflowing.
+            int32_t pd = (int32_t) _kp * error - (int32_t) _kd * dInput;
+            pd = constrain( pd, (int32_t) -65536, (int32_t) 65536 );
+            int32_t output = ( pd << 4 ) + _iTerm;
+            output = constrain( output, outMin, outMax );
+            *_output = output >> 12;
+            return true;
+        }
+
+        void SetTunings(double Kp, double Ki, double Kd)
+        {
+            _dispKp = Kp;
+            _dispKi = Ki;
+            _dispKd = Kd;
+            double sampleTimeInSec = _sampleTime / 1000.0;
+            _kiScale = sampleTimeInSec;
+            _kdScale = 1 / sampleTimeInSec;
+            SetScaledTunings(Kp, Ki * _kiScale, Kd * _kdScale);
+        }
+
+        void ScheduleTunings(double Kp, double Ki, double Kd)
+        {
+            SetScaledTunings(Kp, Ki * _kiScale, Kd * _kdScale);
+        }
+
+        void SetScaledTunings(double Kp, double Ki, double Kd)
+        {
+            if( Kp < 0 || Ki < 0 || Kd < 0 )
+            {
+                return;
+            }
+            _kp = min(Kp * 256, 32767.0);
+            _ki = min(Ki * 4096, 32767.0);
+            _kd = min(Kd * 256, 32767.0);
+        }
+
+        void SetSampleTime(int NewSampleTime)
+        {
+            BricktronicsControllerBase::SetSampleTime(NewSampleTime);
+            SetTunings(_dispKp, _dispKi, _dispKd);
+        }
+
+        double GetKp(void)
+        {
+            return _dispKp;
+        }
+        double GetKi(void)
+        {
+            return _dispKi;
+        }
+        double GetKd(void)
+        {
+            return _dispKd;
+        }
+        double GetITerm(void)
+        {
+            return _iTerm / 4096.0;
+        }
+
+    private:
+        int16_t _kp, _ki, _kd;
+        double _dispKp, _dispKi, _dispKd;
+        // The sample time scaling for Ki and Kd, see SetTunings()
+        double _kiScale, _kdScale;
+        int32_t _iTerm;
+        int32_t _lastInput;
+};
+
+
+// Full state feedback on the position and speed of the motor, plus an
+// integral of the position error to take care of friction and steady loads:
+// output = Kpos * error - Kvel * speed + Ki * integral(error)
+// Tunings: Kpos (drive per tick), Kvel (drive per tick/second), Ki (drive per
+// tick-second). The speed is measured from the change in position since the
+// last sample. Unlike the PID, the gains don't change with the sample time.
+class BricktronicsStateFeedbackController : public BricktronicsControllerBase
+{
+    public:
+        static const bool PIDTunings = false;
+
+        BricktronicsStateFeedbackController(double *input, double *output, double *setpoint):
+            BricktronicsControllerBase(input, output, setpoint),
+            _kPos(BRICKTRONICS_STATE_FEEDBACK_KPOS),
+            _kVel(BRICKTRONICS_STATE_FEEDBACK_KVEL),
+            _kI(BRICKTRONICS_STATE_FEEDBACK_KI),
+            _integral(0),
+            _lastInput(0)
+        {
+        }
+
+        bool Compute(void)
+        {
+            if( !_due() )
+            {
+                return false;
+            }
+            double input = *_input;
+            double sampleTimeInSec = _sampleTime / 1000.0;
+            if( _restart )
+            {
+                _integral = ( _kI > 0 ) ? *_output / _kI : 0;
+                _lastInput = input;
+                _restart = false;
+            }
+
+            double error = *_setpoint - input;
+            double speed = ( input - _lastInput ) / sampleTimeInSec;
+            _lastInput = input;
+
+            // Only integrate while the output isn't saturated, so we don't wind up
+            double output = _kPos * error - _kVel * speed + _kI * _integral;
+            if( output < _outMax && output > _outMin )
+            {
+                _integral += error * sampleTimeInSec;
+            }
+            *_output = _limit(output);
+            return true;
+        }
+
+        void SetTunings(double Kpos, double Kvel, double Ki)
+        {
+            SetScaledTunings(Kpos, Kvel, Ki);
+        }
+
+        void ScheduleTunings(double Kpos, double Kvel, double Ki)
+        {
+            SetScaledTunings(Kpos, Kvel, Ki);
+        }
+
+        void SetScaledTunings(double Kpos, double Kvel, double Ki)
+        {
+            if( Kpos < 0 || Kvel < 0 || Ki < 0 )
+            {
+                return;
+            }
+            _kPos = Kpos;
+            _kVel = Kvel;
+            _kI = Ki;
+        }
+
+        double GetKp(void)
+        {
+            return _kPos;
+        }
+        double GetKi(void)
+        {
+            return _kVel;
+        }
+        double GetKd(void)
+        {
+            return _kI;
+        }
+        double GetITerm(void)
+        {
+            return _kI * _integral;
+        }
+
+    private:
+        double _kPos, _kVel, _kI;
+        double _integral;
+        double _lastInput;
+};
+
+
+// Sliding mode control. The sliding surface is s = lambda * error - speed,
+// which is zero when the motor approaches the setpoint with the error
+// shrinking at a rate of lambda per second. The controller pushes the motor
+// onto that surface with the full gain, and inside the boundary layer
+// (|s| < boundary) it scales down linearly to avoid chattering:
+// output = gain * clamp(s / boundary, -1, 1)
+// Tunings: lambda (1/second), gain (drive strength), boundary (ticks/second).
+// It is very robust to load changes, but doesn't remove a steady-state
+// error from a constant load, use setFeedForward() for that.
+class BricktronicsSlidingModeController : public BricktronicsControllerBase
+{
+    public:
+        static const bool PIDTunings = false;
+
+        BricktronicsSlidingModeController(double *input, double *output, double *setpoint):
+            BricktronicsControllerBase(input, output, setpoint),
+            _lastInput(0)
+        {
+            SetTunings(BRICKTRONICS_SLIDING_MODE_LAMBDA, BRICKTRONICS_SLIDING_MODE_GAIN, BRICKTRONICS_SLIDING_MODE_BOUNDARY);
+        }
+
+        bool Compute(void)
+        {
+            if( !_due() )
+            {
+                return false;
+            }
+            double input = *_input;
+            if( _restart )
+            {
+                _lastInput = input;
+                _restart = false;
+            }
+
+            double speed = ( input - _lastInput ) * 1000 / _sampleTime;
+            _lastInput = input;
+            double s = _lambda * ( *_setpoint - input ) - speed;
+            double output = _gain * s * _boundaryInverse;
+            if( output > _gain )
+            {
+                output = _gain;
+            }
+            else if( output < -_gain )
+            {
+                output = -_gain;
+            }
+            *_output = _limit(output);
+            return true;
+        }
+
+        void SetTunings(double lambda, double gain, double boundary)
+        {
+            SetScaledTunings(lambda, gain, boundary);
+        }
+
+        void ScheduleTunings(double lambda, double gain, double boundary)
+        {
+            SetScaledTunings(lambda, gain, boundary);
+        }
+
+        void SetScaledTunings(double lambda, double gain, double boundary)
+        {
+            if( lambda < 0 || gain < 0 || boundary <= 0 )
+            {
+                return;
+            }
+            _lambda = lambda;
+            _gain = gain;
+            _boundary = boundary;
+            _boundaryInverse = 1.0 / boundary;
+        }
+
+        double GetKp(void)
+        {
+            return _lambda;
+        }
+        double GetKi(void)
+        {
+            return _gain;
+        }
+        double GetKd(void)
+        {
+            return _boundary;
+        }
+
+    private:
+        double _lambda, _gain, _boundary, _boundaryInverse;
+        double _lastInput;
+};
+
+
+// Bang-bang control, the simplest controller there is: full drive towards
+// the setpoint, and nothing at all inside the deadband around it. Cheap and
+// fast, but it will usually overshoot a little and hunt around the setpoint.
+// Tunings: drive (drive strength), deadband (ticks), the third is unused.
+class BricktronicsBangBangController : public BricktronicsControllerBase
+{
+    public:
+        static const bool PIDTunings = false;
+
+        BricktronicsBangBangController(double *input, double *output, double *setpoint):
+            BricktronicsControllerBase(input, output, setpoint),
+            _drive(BRICKTRONICS_BANG_BANG_DRIVE),
+            _deadband(BRICKTRONICS_BANG_BANG_DEADBAND)
+        {
+        }
+
+        bool Compute(void)
+        {
+            if( !_due() )
+            {
+                return false;
+            }
+            int32_t error = *_setpoint - *_input;
+            if( error > _deadband )
+            {
+                *_output = _limit(_drive);
+            }
+            else if( error < -_deadband )
+            {
+                *_output = _limit(-_drive);
+            }
+            else
+            {
+                *_output = 0;
+            }
+            return true;
+        }
+
+        void SetTunings(double drive, double deadband, double unused)
+        {
+            SetScaledTunings(drive, deadband, unused);
+        }
+
+        void ScheduleTunings(double drive, double deadband, double unused)
+        {
+            SetScaledTunings(drive, deadband, unused);
+        }
+
+        void SetScaledTunings(double drive, double deadband, double)
+        {
+            if( drive < 0 || deadband < 0 )
+            {
+                return;
+            }
+            _drive = drive;
+            _deadband = deadband;
+        }
+
+        double GetKp(void)
+        {
+            return _drive;
+        }
+        double GetKi(void)
+        {
+            return _deadband;
+        }
+        double GetKd(void)
+        {
+            return 0;
+        }
+
+    private:
+        int16_t _drive;
+        int16_t _deadband;
+};
+
+#endif // #ifndef BRICKTRONICSCONTROLLERS_H
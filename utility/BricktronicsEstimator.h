@@ -0,0 +1,249 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSESTIMATOR_H
+#define BRICKTRONICSESTIMATOR_H
+
+// Alpha-beta-gamma filter that estimates the position, speed and
+// acceleration of a motor from its encoder readings.
+//
+// Differentiating the encoder position directly gives a very coarse speed
+// (one tick in 10 ms is already 100 ticks per second), so instead we keep a
+// running estimate of the motor's state, predict where it should be at each
+// sample, and nudge the estimate towards the encoder reading by a fixed
+// fraction of the difference. The three gains come from a single smoothing
+// factor theta (the "fading memory" filter): theta near 0 follows the encoder
+// closely, theta near 1 smooths more but lags more.
+//
+// Everything is integer math, and each sample takes the same (short) time.
+// The position is kept with 8 fractional bits, relative to a whole tick
+// position that follows it along (so it doesn't overflow however far the
+// motor goes), and the speed (ticks per second) and acceleration (ticks per
+// second per second) with 4 fractional bits each.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// How often the filter samples the encoder, and the default smoothing factor.
+#define BRICKTRONICS_ESTIMATOR_SAMPLE_TIME_US               2000
+#define BRICKTRONICS_ESTIMATOR_THETA                        0.8
+
+// If the encoder reading is ever this far (in ticks) from the prediction,
+// like after setPosition(), the filter starts over from the reading.
+#define BRICKTRONICS_ESTIMATOR_RESET_ERROR                  100
+
+// If update() is late, the filter predicts ahead one sample time at a time
+// to catch up, for up to this many sample times. After a longer gap, it
+// starts over from the reading.
+#define BRICKTRONICS_ESTIMATOR_MAX_CATCH_UP                 8
+
+// The acceleration estimate (with 4 fractional bits) is limited to this
+#define BRICKTRONICS_ESTIMATOR_MAX_ACCELERATION             2097152L
+
+class BricktronicsEstimator
+{
+    public:
+        BricktronicsEstimator():
+            _sampleTimeUS(BRICKTRONICS_ESTIMATOR_SAMPLE_TIME_US),
+            _started(false)
+        {
+            setSmoothing(BRICKTRONICS_ESTIMATOR_THETA);
+        }
+
+        // Set the smoothing factor theta, between 0.5 and 1. Below 0.5 the
+        // filter barely smooths at all, and the gains get too big for the
+        // integer math.
+        void setSmoothing(double theta)
+        {
+            if( theta < 0.5 || theta >= 1 )
+            {
+                return;
+            }
+            _theta = theta;
+            double T = _sampleTimeUS / 1000000.0;
+            double oneMinus = 1 - theta;
+            double alpha = 1 - theta * theta * theta;
+            double beta = 1.5 * oneMinus * oneMinus * ( 1 + theta );
+            double gamma = oneMinus * oneMinus * oneMinus;
+            _alpha = alpha * 256 + 0.5;
+            // Speed correction per tick of error, with 4 fractional bits
+            _beta = beta / T * 16 + 0.5;
+            // Acceleration correction per tick of error, with 4 fractional bits
+            // (and the error's own 8 fractional bits cut down to 4)
+            _gamma = gamma / ( T * T ) + 0.5;
+            // The prediction step multiplies by the sample time in units of
+            // 1/65536 second.
+            _dt = T * 65536 + 0.5;
+        }
+        double getSmoothing(void)
+        {
+            return _theta;
+        }
+
+        // Set how often (in microseconds) the filter samples the encoder,
+        // between 1000 and 10000. Defaults to 2000.
+        void setSampleTimeUS(uint16_t sampleTimeUS)
+        {
+            if( sampleTimeUS < 1000 || sampleTimeUS > 10000 )
+            {
+                return;
+            }
+            _sampleTimeUS = sampleTimeUS;
+            setSmoothing(_theta);
+        }
+        uint16_t getSampleTimeUS(void)
+        {
+            return _sampleTimeUS;
+        }
+
+        // Feed in an encoder reading, usually from the motor's update().
+        // Returns true if it was time for a new sample.
+        bool update(int32_t position, unsigned long nowUS)
+        {
+            if( !_started )
+            {
+                reset(position, nowUS);
+                return true;
+            }
+            unsigned long elapsed = nowUS - _lastTimeUS;
+            if( elapsed < _sampleTimeUS )
+            {
+                return false;
+            }
+            _lastTimeUS = nowUS;
+
+            // Predict where the motor should be now, one sample time at a
+            // time, since the gains are only right for one sample time, and
+            // then the rest of the way. steps ends up as the number of sample
+            // times since the last reading, rounded.
+            uint8_t steps = 0;
+            while( elapsed >= _sampleTimeUS )
+            {
+                if( ++steps > BRICKTRONICS_ESTIMATOR_MAX_CATCH_UP )
+                {
+                    reset(position, nowUS);
+                    return true;
+                }
+                elapsed -= _sampleTimeUS;
+                _predict(_dt);
+            }
+            // In units of 1/65536 second, 4295 / 65536 is 65536 / 1000000
+            _predict(( elapsed * 4295 ) >> 16);
+            if( elapsed >= _sampleTimeUS / 2 )
+            {
+                steps++;
+            }
+
+            // Move the whole ticks over to the origin
+            int32_t whole = _position >> 8;
+            _origin += whole;
+            _position -= whole * 256;
+
+            // Correct the prediction by the measured error
+            int32_t error = (int32_t) ( (uint32_t) position - (uint32_t) _origin ) * 256 - _position;
+            if( error > ( (int32_t) BRICKTRONICS_ESTIMATOR_RESET_ERROR << 8 ) || error < -( (int32_t) BRICKTRONICS_ESTIMATOR_RESET_ERROR << 8 ) )
+            {
+                reset(position, nowUS);
+                return true;
+            }
+            _position += ( error * _alpha ) >> 8;
+            int32_t speedCorrection = ( error * _beta ) >> 8;
+            int32_t accelerationCorrection = ( ( error >> 2 ) * _gamma ) >> 2;
+            if( steps > 1 )
+            {
+                // The error built up over several sample times, so it says
+                // that much less about the speed and acceleration
+                speedCorrection /= steps;
+                accelerationCorrection /= steps * steps;
+            }
+            _speed += speedCorrection;
+            _acceleration += accelerationCorrection;
+            // Keep the acceleration within about twice what a motor can do
+            // (a full reversal), so the prediction step can't overflow.
+            if( _acceleration > BRICKTRONICS_ESTIMATOR_MAX_ACCELERATION )
+            {
+                _acceleration = BRICKTRONICS_ESTIMATOR_MAX_ACCELERATION;
+            }
+            else if( _acceleration < -BRICKTRONICS_ESTIMATOR_MAX_ACCELERATION )
+            {
+                _acceleration = -BRICKTRONICS_ESTIMATOR_MAX_ACCELERATION;
+            }
+            return true;
+        }
+
+        // Start over from a motor at rest at the given position.
+        void reset(int32_t position, unsigned long nowUS)
+        {
+            _origin = position;
+            _position = 0;
+            _speed = 0;
+            _acceleration = 0;
+            _lastTimeUS = nowUS;
+            _started = true;
+        }
+
+        // The estimates, in ticks, ticks per second and ticks per second per second.
+        int32_t getPosition(void)
+        {
+            return _origin + ( ( _position + 128 ) >> 8 );
+        }
+        int32_t getSpeed(void)
+        {
+            return ( _speed + 8 ) >> 4;
+        }
+        int32_t getAcceleration(void)
+        {
+            return ( _acceleration + 8 ) >> 4;
+        }
+
+    private:
+        // Moves the estimate dt (in units of 1/65536 second) ahead
+        void _predict(uint16_t dt)
+        {
+            _position += ( _speed * dt ) >> 12;
+            _speed += ( _acceleration * dt ) >> 16;
+        }
+
+        int32_t _origin;
+        int32_t _position;
+        int32_t _speed;
+        int32_t _acceleration;
+        int16_t _alpha;
+        int32_t _beta;
+        int32_t _gamma;
+        uint16_t _dt;
+        double _theta;
+        uint16_t _sampleTimeUS;
+        unsigned long _lastTimeUS;
+        bool _started;
+};
+
+#endif // #ifndef BRICKTRONICSESTIMATOR_H
@@ -0,0 +1,177 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSKINEMATICS_H
+#define BRICKTRONICSKINEMATICS_H
+
+// Kinematics for a two-link arm (like a SCARA arm) in a plane: the shoulder
+// motor turns the first link around the origin, and the elbow motor turns
+// the second link at the end of the first one.
+//
+// Forward kinematics go from the motor positions to where the end of the
+// arm is, and inverse kinematics the other way around. Both use the integer
+// trig in BricktronicsTrig.h, so they're quick enough to run for every
+// sample of a coordinated move.
+//
+// Lengths can be in any units (tenths of a millimeter works well), as long
+// as both links together are shorter than 32768. Joint angles are binary
+// angles (65536 is a full turn, see BricktronicsTrig.h), counter-clockwise.
+// Both joint angles are 0 with the arm stretched out straight along the X
+// axis, and the elbow angle is measured from the first link. Motor positions
+// are 0 there too.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include "BricktronicsTrig.h"
+
+class BricktronicsTwoLinkArm
+{
+    public:
+        // The lengths of both links, and how many motor encoder ticks it takes
+        // to turn each joint all the way around (720 times the gear ratio).
+        BricktronicsTwoLinkArm(uint16_t length1, uint16_t length2, uint16_t ticksPerTurn1, uint16_t ticksPerTurn2):
+            _length1(length1),
+            _length2(length2),
+            _ticksPerTurn1(ticksPerTurn1),
+            _ticksPerTurn2(ticksPerTurn2),
+            _elbowPositive(true)
+        {
+            // A full turn (2^32) is ticksPerTurn ticks
+            _scale1 = 4294967296.0 / ticksPerTurn1;
+            _scale2 = 4294967296.0 / ticksPerTurn2;
+        }
+
+        // Most points can be reached with the elbow bent either way. Positive
+        // (the default) bends the elbow counter-clockwise.
+        void setElbowPositive(bool positive)
+        {
+            _elbowPositive = positive;
+        }
+        bool getElbowPositive(void)
+        {
+            return _elbowPositive;
+        }
+
+        // Where the end of the arm is for the given joint angles
+        void forwardAngles(uint16_t angle1, uint16_t angle2, int32_t *x, int32_t *y)
+        {
+            uint16_t angle = angle1 + angle2;
+            // Each link times a result with 15 fractional bits
+            int32_t sumX = (int32_t) _length1 * BricktronicsTrig::cosine(angle1) + (int32_t) _length2 * BricktronicsTrig::cosine(angle);
+            int32_t sumY = (int32_t) _length1 * BricktronicsTrig::sine(angle1) + (int32_t) _length2 * BricktronicsTrig::sine(angle);
+            *x = ( sumX + 16384 ) >> 15;
+            *y = ( sumY + 16384 ) >> 15;
+        }
+
+        // The joint angles that put the end of the arm at (x, y). Returns
+        // false, and leaves the angles alone, if it can't reach that far (or
+        // that close to the shoulder).
+        bool inverseAngles(int32_t x, int32_t y, uint16_t *angle1, uint16_t *angle2)
+        {
+            uint32_t reach = (uint32_t) _length1 + _length2;
+            if( x > (int32_t) reach || x < - (int32_t) reach || y > (int32_t) reach || y < - (int32_t) reach )
+            {
+                return false;
+            }
+            uint32_t distanceSquared = (uint32_t) ( x * x ) + (uint32_t) ( y * y );
+            if( distanceSquared > reach * reach )
+            {
+                return false;
+            }
+
+            // The law of cosines: cos(elbow) = D / K
+            int32_t d = (int32_t) distanceSquared - (int32_t) _length1 * _length1 - (int32_t) _length2 * _length2;
+            int32_t k = 2 * (int32_t) _length1 * _length2;
+            if( d > k || d < -k )
+            {
+                return false;
+            }
+            // sin(elbow) = sqrt( K^2 - D^2 ) / K, which needs K to be scaled
+            // down to 15 bits first so the product fits.
+            while( k >= 32768 )
+            {
+                k >>= 1;
+                d >>= 1;
+            }
+            int32_t s = BricktronicsTrig::squareRoot((uint32_t) ( k - d ) * (uint32_t) ( k + d ));
+            uint16_t elbow = BricktronicsTrig::arctan2(_elbowPositive ? s : -s, d);
+
+            // The shoulder points at (x, y), less the angle the bent elbow
+            // adds on.
+            int32_t alongX = (int32_t) _length1 * 32767 + (int32_t) _length2 * BricktronicsTrig::cosine(elbow);
+            int32_t alongY = (int32_t) _length2 * BricktronicsTrig::sine(elbow);
+            *angle1 = BricktronicsTrig::arctan2(y, x) - BricktronicsTrig::arctan2(alongY, alongX);
+            *angle2 = elbow;
+            return true;
+        }
+
+        // The same as above, but in motor positions (encoder ticks).
+        void forward(int32_t position1, int32_t position2, int32_t *x, int32_t *y)
+        {
+            forwardAngles(_positionToAngle(position1, _scale1), _positionToAngle(position2, _scale2), x, y);
+        }
+        bool inverse(int32_t x, int32_t y, int32_t *position1, int32_t *position2)
+        {
+            uint16_t angle1, angle2;
+            if( !inverseAngles(x, y, &angle1, &angle2) )
+            {
+                return false;
+            }
+            *position1 = _angleToPosition(angle1, _ticksPerTurn1);
+            *position2 = _angleToPosition(angle2, _ticksPerTurn2);
+            return true;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        uint16_t _length1, _length2;
+        uint16_t _ticksPerTurn1, _ticksPerTurn2;
+        uint32_t _scale1, _scale2;
+        bool _elbowPositive;
+
+        // Motor positions wrap around to angles on their own, since a full
+        // turn of ticks times the scale is 2^32.
+        static uint16_t _positionToAngle(int32_t position, uint32_t scale)
+        {
+            return ( (uint32_t) position * scale + 0x8000 ) >> 16;
+        }
+
+        // Joint angles are -180 to 180 degrees from the straight out position
+        static int32_t _angleToPosition(uint16_t angle, uint16_t ticksPerTurn)
+        {
+            return ( (int32_t) (int16_t) angle * ticksPerTurn + 0x7FFF ) >> 16;
+        }
+};
+
+#endif // #ifndef BRICKTRONICSKINEMATICS_H
@@ -0,0 +1,324 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSPROTOCOL_H
+#define BRICKTRONICSPROTOCOL_H
+
+// The frames of the binary motor command protocol (see
+// BricktronicsMotorProtocol.h), and the command numbers. This only needs
+// stdint.h and string.h, so the same file works on a computer talking to the
+// Arduino.
+//
+// A frame is:
+//
+//   0xB5  length  sequence  command  payload (length bytes)  CRC (2 bytes)
+//
+// The CRC is the CRC-16 used by XMODEM, but starting from 0xFFFF (also known
+// as CRC-16/CCITT-FALSE), of everything from the length to the end of the
+// payload, low byte first. Numbers in the payload are low byte first too.
+//
+// Frames that don't add up (a bad CRC, or a length that's too long) are
+// dropped, and the decoder looks for the next 0xB5. Sequence numbers catch
+// the dropped ones: the sender numbers its frames 0, 1, 2... (wrapping
+// around at 256), and frames get a reply with their sequence number.
+
+#include <stdint.h>
+#include <string.h>
+#if defined(__AVR__)
+#include <util/crc16.h>
+#endif
+
+#define BRICKTRONICS_PROTOCOL_VERSION                       1
+#define BRICKTRONICS_PROTOCOL_START                         0xB5
+
+// The most motors a command can pick, so the biggest frames fit below
+#define BRICKTRONICS_PROTOCOL_MAX_MOTORS                    6
+
+// The largest payload. That's the reply to a status query for 6 motors: the
+// status (1), room (1), busy (1), and 7 bytes for each motor.
+#define BRICKTRONICS_PROTOCOL_MAX_PAYLOAD                   45
+
+// The largest payload of a queued command. That's a move for 6 motors: the
+// motors (1), the duration (2), and a position for each (4 each).
+#define BRICKTRONICS_PROTOCOL_MAX_COMMAND                   27
+
+// The start, length, sequence, command and CRC around the payload
+#define BRICKTRONICS_PROTOCOL_OVERHEAD                      6
+
+// Commands. Motors are picked with a bit mask (bit 0 is the first motor),
+// and the values that follow are for each picked motor, in order.
+//
+// Answered right away:
+// Ping: no payload. Resets the sequence numbers, so the next frame is the
+// one after the ping. The reply is the protocol version and the number of
+// motors.
+#define BRICKTRONICS_PROTOCOL_PING                          0x01
+// Status: the motors (1). The reply is whether the queue is busy (1), then
+// for each motor its position (4), speed (2) and mode (1).
+#define BRICKTRONICS_PROTOCOL_STATUS                        0x02
+// Stop: the motors (1). Empties the queue, and holds those motors where
+// they are.
+#define BRICKTRONICS_PROTOCOL_STOP                          0x03
+//
+// Queued, and run one after another:
+// Move: the motors (1), the duration in ms (2), then a position for each
+// motor (4 each). The next command starts after the duration, or once all
+// the motors have settled there if the duration is 0.
+#define BRICKTRONICS_PROTOCOL_MOVE                          0x10
+// Speed: the motors (1), then a speed (ticks per second) for each (2 each)
+#define BRICKTRONICS_PROTOCOL_SPEED                         0x11
+// Line and arc, for a motor group: x (4), y (4), speed (2), or center x (4),
+// center y (4), degrees (2), speed (2). These go into the group's queue.
+#define BRICKTRONICS_PROTOCOL_LINE                          0x12
+#define BRICKTRONICS_PROTOCOL_ARC                           0x13
+//
+// Sent by the Arduino on its own, not as replies:
+// Telemetry (see BricktronicsMotorTelemetry.h): the motor (1), the time in
+// microseconds (4), setpoint (4), position (4), output (2), mode (1) and
+// flags (1). The sequence number counts every telemetry frame, including the
+// ones dropped because the serial port was busy, so a gap shows how many
+// were lost.
+#define BRICKTRONICS_PROTOCOL_TELEMETRY                     0x40
+#define BRICKTRONICS_PROTOCOL_TELEMETRY_SIZE                17
+#define BRICKTRONICS_PROTOCOL_TELEMETRY_STALLED             0x01
+#define BRICKTRONICS_PROTOCOL_TELEMETRY_SATURATED           0x02
+
+// Replies have this bit set in the command, and start with a status and how
+// many more commands the queue has room for.
+#define BRICKTRONICS_PROTOCOL_REPLY                         0x80
+#define BRICKTRONICS_PROTOCOL_OK                            0
+// The queue was full, so send it again later
+#define BRICKTRONICS_PROTOCOL_QUEUE_FULL                    1
+// An earlier frame was lost. The reply's payload is the sequence number it
+// was expecting, so start again from there. Only the first frame after a lost
+// (or not taken) one gets this reply, the ones after that are dropped without
+// an answer, until the expected one comes.
+#define BRICKTRONICS_PROTOCOL_OUT_OF_SEQUENCE               2
+// An unknown command, or the wrong length for it
+#define BRICKTRONICS_PROTOCOL_BAD_COMMAND                   3
+// This frame arrived already (its reply was probably lost), and wasn't run
+// again
+#define BRICKTRONICS_PROTOCOL_DUPLICATE                     4
+
+class BricktronicsProtocol
+{
+    public:
+        static uint16_t crc(uint16_t crc, uint8_t data)
+        {
+#if defined(__AVR__)
+            return _crc_xmodem_update(crc, data);
+#else
+            crc ^= (uint16_t) data << 8;
+            for( uint8_t i = 0; i < 8; i++ )
+            {
+                crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : crc << 1;
+            }
+            return crc;
+#endif
+        }
+
+        // Puts a frame together in buffer, which needs room for the payload
+        // and BRICKTRONICS_PROTOCOL_OVERHEAD more. Returns the frame's length.
+        static uint8_t encode(uint8_t *buffer, uint8_t sequence, uint8_t command, const uint8_t *payload, uint8_t length)
+        {
+            buffer[0] = BRICKTRONICS_PROTOCOL_START;
+            buffer[1] = length;
+            buffer[2] = sequence;
+            buffer[3] = command;
+            for( uint8_t i = 0; i < length; i++ )
+            {
+                buffer[4 + i] = payload[i];
+            }
+            uint16_t check = 0xFFFF;
+            for( uint8_t i = 1; i < length + 4; i++ )
+            {
+                check = crc(check, buffer[i]);
+            }
+            buffer[length + 4] = check;
+            buffer[length + 5] = check >> 8;
+            return length + BRICKTRONICS_PROTOCOL_OVERHEAD;
+        }
+
+        // Numbers in payloads, low byte first
+        static void putInt16(uint8_t *buffer, int16_t value)
+        {
+            buffer[0] = value;
+            buffer[1] = (uint16_t) value >> 8;
+        }
+        static void putInt32(uint8_t *buffer, int32_t value)
+        {
+            putInt16(buffer, value);
+            putInt16(buffer + 2, (uint32_t) value >> 16);
+        }
+        static int16_t getInt16(const uint8_t *buffer)
+        {
+            return buffer[0] | ( (uint16_t) buffer[1] << 8 );
+        }
+        static int32_t getInt32(const uint8_t *buffer)
+        {
+            return (uint16_t) getInt16(buffer) | ( (uint32_t) (uint16_t) getInt16(buffer + 2) << 16 );
+        }
+        // Floats are 4 byte IEEE floats, also low byte first
+        static void putFloat(uint8_t *buffer, float value)
+        {
+            int32_t bits;
+            memcpy(&bits, &value, 4);
+            putInt32(buffer, bits);
+        }
+        static float getFloat(const uint8_t *buffer)
+        {
+            int32_t bits = getInt32(buffer);
+            float value;
+            memcpy(&value, &bits, 4);
+            return value;
+        }
+
+        // The number of motors picked in a mask
+        static uint8_t countMotors(uint8_t mask)
+        {
+            uint8_t count = 0;
+            for( ; mask; mask >>= 1 )
+            {
+                count += mask & 1;
+            }
+            return count;
+        }
+};
+
+// Pulls frames out of a stream of bytes, one byte at a time.
+class BricktronicsFrameDecoder
+{
+    public:
+        BricktronicsFrameDecoder():
+            _state(0),
+            _errors(0)
+        {
+        }
+
+        // Feeds in the next byte. Returns true when that finishes a good
+        // frame, which stays put until the next byte comes in.
+        bool decode(uint8_t data)
+        {
+            switch( _state )
+            {
+                case 0:
+                    // Looking for the start of a frame
+                    if( data == BRICKTRONICS_PROTOCOL_START )
+                    {
+                        _state = 1;
+                        _crc = 0xFFFF;
+                    }
+                    return false;
+                case 1:
+                    if( data > BRICKTRONICS_PROTOCOL_MAX_PAYLOAD )
+                    {
+                        _errors++;
+                        _state = 0;
+                        return false;
+                    }
+                    _length = data;
+                    break;
+                case 2:
+                    _sequence = data;
+                    break;
+                case 3:
+                    _command = data;
+                    _index = 0;
+                    if( _length == 0 )
+                    {
+                        // Skip over the payload
+                        _state++;
+                    }
+                    break;
+                case 4:
+                    _payload[_index++] = data;
+                    _crc = BricktronicsProtocol::crc(_crc, data);
+                    if( _index < _length )
+                    {
+                        return false;
+                    }
+                    _state = 5;
+                    return false;
+                case 5:
+                    if( data != (uint8_t) _crc )
+                    {
+                        _errors++;
+                        _state = 0;
+                        return false;
+                    }
+                    _state = 6;
+                    return false;
+                default:
+                    _state = 0;
+                    if( data != (uint8_t) ( _crc >> 8 ) )
+                    {
+                        _errors++;
+                        return false;
+                    }
+                    return true;
+            }
+            _crc = BricktronicsProtocol::crc(_crc, data);
+            _state++;
+            return false;
+        }
+
+        uint8_t getSequence(void)
+        {
+            return _sequence;
+        }
+        uint8_t getCommand(void)
+        {
+            return _command;
+        }
+        uint8_t getLength(void)
+        {
+            return _length;
+        }
+        const uint8_t *getPayload(void)
+        {
+            return _payload;
+        }
+
+        // How many frames have been dropped for a bad CRC or length
+        uint16_t getErrors(void)
+        {
+            return _errors;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        uint8_t _state;
+        uint8_t _length, _sequence, _command;
+        uint8_t _index;
+        uint16_t _crc;
+        uint16_t _errors;
+        uint8_t _payload[BRICKTRONICS_PROTOCOL_MAX_PAYLOAD];
+};
+
+#endif // #ifndef BRICKTRONICSPROTOCOL_H
@@ -0,0 +1,235 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSREGISTERS_H
+#define BRICKTRONICSREGISTERS_H
+
+// The register map of a motor co-processor (see
+// BricktronicsMotorRegisters.h), and the master side that talks to one. Like
+// the serial protocol, this only needs the standard C headers, so the master
+// can run on another Arduino or on a computer.
+//
+// Each motor has a block of 32 registers, starting at 32 times its number
+// (so up to 8 motors fit in the 256 addresses). A transaction starts with a
+// register address, and then reads or writes the registers from there on,
+// one after another. Multi-byte numbers are low byte first, and the gains are
+// 4 byte IEEE floats.
+//
+//   0x00  mode (1)       read/write, one of BRICKTRONICS_MOTOR_MODE_*
+//   0x01  status (1)     read only, see below
+//   0x02  setpoint (4)   read/write, a position, a speed (ticks per second),
+//                        or a fixed drive strength, depending on the mode
+//   0x06  position (4)   read only
+//   0x0A  speed (2)      read only, ticks per second
+//   0x0C  output (2)     read only, the drive strength (-255 to 255)
+//   0x10  Kp (4)         read/write, the position PID gains
+//   0x14  Ki (4)
+//   0x18  Kd (4)
+//
+// Writing the mode or the setpoint sends the motor there (coast, brake,
+// fixed drive, position, speed, cascaded position or minimum-time position),
+// on the co-processor's next update(). Write both in one transaction to
+// change modes. The other addresses read as 0, and writes to them (and to the
+// read-only registers) are ignored.
+
+#include <stdint.h>
+#include "BricktronicsProtocol.h"
+
+#define BRICKTRONICS_REGISTERS_MOTOR_SIZE                   0x20
+#define BRICKTRONICS_REGISTERS_MAX_MOTORS                   8
+
+#define BRICKTRONICS_REGISTERS_MODE                         0x00
+#define BRICKTRONICS_REGISTERS_STATUS                       0x01
+#define BRICKTRONICS_REGISTERS_SETPOINT                     0x02
+#define BRICKTRONICS_REGISTERS_POSITION                     0x06
+#define BRICKTRONICS_REGISTERS_SPEED                        0x0A
+#define BRICKTRONICS_REGISTERS_OUTPUT                       0x0C
+#define BRICKTRONICS_REGISTERS_KP                           0x10
+#define BRICKTRONICS_REGISTERS_KI                           0x14
+#define BRICKTRONICS_REGISTERS_KD                           0x18
+// The mode through the output, which the master reads in one go
+#define BRICKTRONICS_REGISTERS_STATE_SIZE                   0x0E
+
+// Status bits
+// In a position mode, and settled at the setpoint
+#define BRICKTRONICS_REGISTERS_STATUS_SETTLED               0x01
+// Stalled, see stallSetThresholds()
+#define BRICKTRONICS_REGISTERS_STATUS_STALLED               0x02
+// A write hasn't been picked up by update() yet
+#define BRICKTRONICS_REGISTERS_STATUS_PENDING               0x04
+
+// What the master reads about a motor, see readState()
+typedef struct BricktronicsMotorRegisterState
+{
+   uint8_t mode;
+   uint8_t status;
+   int32_t setpoint;
+   int32_t position;
+   int16_t speed;
+   int16_t output;
+} BricktronicsMotorRegisterState;
+
+// The bus between the master and the co-processor. Make a subclass of this for
+// Wire or SPI, so the master can use it.
+class BricktronicsRegisterBus
+{
+    public:
+        virtual ~BricktronicsRegisterBus() {}
+
+        // Writes length bytes to the registers from address on. Returns false
+        // if it didn't go through.
+        virtual bool writeRegisters(uint8_t address, const uint8_t *data, uint8_t length) = 0;
+
+        // Reads length bytes from the registers from address on. Returns
+        // false if it didn't go through.
+        virtual bool readRegisters(uint8_t address, uint8_t *data, uint8_t length) = 0;
+};
+
+// A stand-in bus, for testing a master and a co-processor in the same
+// program (on a computer, for example). It calls the co-processor's bus
+// functions directly, just like the I2C or SPI interrupts would.
+template <class Slave>
+class BricktronicsLoopbackBus : public BricktronicsRegisterBus
+{
+    public:
+        // The co-processor is not copied, so it needs to stay around.
+        BricktronicsLoopbackBus(Slave &slave):
+            _slave(slave)
+        {
+        }
+
+        bool writeRegisters(uint8_t address, const uint8_t *data, uint8_t length)
+        {
+            _slave.busStart(address);
+            for( uint8_t i = 0; i < length; i++ )
+            {
+                _slave.busWrite(data[i]);
+            }
+            _slave.busStop();
+            return true;
+        }
+
+        bool readRegisters(uint8_t address, uint8_t *data, uint8_t length)
+        {
+            _slave.busStart(address);
+            for( uint8_t i = 0; i < length; i++ )
+            {
+                data[i] = _slave.busRead();
+            }
+            _slave.busStop();
+            return true;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        Slave &_slave;
+};
+
+// The master side: reads and writes a co-processor's motor registers over a
+// bus.
+class BricktronicsRegisterMaster
+{
+    public:
+        // The bus is not copied, so it needs to stay around (a global
+        // variable is easiest).
+        BricktronicsRegisterMaster(BricktronicsRegisterBus &bus):
+            _bus(bus)
+        {
+        }
+
+        // Sends a motor into a mode, with a setpoint, in one transaction.
+        bool setMode(uint8_t motor, uint8_t mode, int32_t setpoint)
+        {
+            // The status in between is read only, so it's ignored
+            uint8_t data[6] = { mode, 0 };
+            BricktronicsProtocol::putInt32(data + 2, setpoint);
+            return _bus.writeRegisters(_address(motor, BRICKTRONICS_REGISTERS_MODE), data, 6);
+        }
+
+        // Changes a motor's setpoint, in the mode it's in
+        bool setSetpoint(uint8_t motor, int32_t setpoint)
+        {
+            uint8_t data[4];
+            BricktronicsProtocol::putInt32(data, setpoint);
+            return _bus.writeRegisters(_address(motor, BRICKTRONICS_REGISTERS_SETPOINT), data, 4);
+        }
+
+        bool setGains(uint8_t motor, float Kp, float Ki, float Kd)
+        {
+            uint8_t data[12];
+            BricktronicsProtocol::putFloat(data, Kp);
+            BricktronicsProtocol::putFloat(data + 4, Ki);
+            BricktronicsProtocol::putFloat(data + 8, Kd);
+            return _bus.writeRegisters(_address(motor, BRICKTRONICS_REGISTERS_KP), data, 12);
+        }
+
+        bool getGains(uint8_t motor, float *Kp, float *Ki, float *Kd)
+        {
+            uint8_t data[12];
+            if( !_bus.readRegisters(_address(motor, BRICKTRONICS_REGISTERS_KP), data, 12) )
+            {
+                return false;
+            }
+            *Kp = BricktronicsProtocol::getFloat(data);
+            *Ki = BricktronicsProtocol::getFloat(data + 4);
+            *Kd = BricktronicsProtocol::getFloat(data + 8);
+            return true;
+        }
+
+        // Reads the mode, status, setpoint, position, speed and output of a
+        // motor in one transaction, so they all come from the same update().
+        bool readState(uint8_t motor, BricktronicsMotorRegisterState *state)
+        {
+            uint8_t data[BRICKTRONICS_REGISTERS_STATE_SIZE];
+            if( !_bus.readRegisters(_address(motor, BRICKTRONICS_REGISTERS_MODE), data, BRICKTRONICS_REGISTERS_STATE_SIZE) )
+            {
+                return false;
+            }
+            state->mode = data[BRICKTRONICS_REGISTERS_MODE];
+            state->status = data[BRICKTRONICS_REGISTERS_STATUS];
+            state->setpoint = BricktronicsProtocol::getInt32(data + BRICKTRONICS_REGISTERS_SETPOINT);
+            state->position = BricktronicsProtocol::getInt32(data + BRICKTRONICS_REGISTERS_POSITION);
+            state->speed = BricktronicsProtocol::getInt16(data + BRICKTRONICS_REGISTERS_SPEED);
+            state->output = BricktronicsProtocol::getInt16(data + BRICKTRONICS_REGISTERS_OUTPUT);
+            return true;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+        BricktronicsRegisterBus &_bus;
+
+        static uint8_t _address(uint8_t motor, uint8_t offset)
+        {
+            return motor * BRICKTRONICS_REGISTERS_MOTOR_SIZE + offset;
+        }
+};
+
+#endif // #ifndef BRICKTRONICSREGISTERS_H
@@ -0,0 +1,218 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSTIMING_H
+#define BRICKTRONICSTIMING_H
+
+// A cheap clock and small histograms, for measuring how long things take
+// (see BRICKTRONICS_MOTOR_TIMING in BricktronicsMotor.h).
+//
+// BRICKTRONICS_TIMING_TICKS() reads the fastest counter the board has:
+// * On AVR boards, Timer 0 (the one behind millis()), extended with its
+//   overflow count. A tick is 64 clock cycles, 4 us at 16 MHz. That's the
+//   same clock as micros(), without the multiply.
+// * On ARM boards with a DWT cycle counter (Cortex-M3 and up, like the Due),
+//   the cycle counter itself, which it turns on the first time.
+// * Anywhere else, micros().
+// To use some other clock (a virtual one, when running on a computer, for
+// example), define BRICKTRONICS_TIMING_TICKS() and
+// BRICKTRONICS_TIMING_TICKS_TO_US() before including the library.
+//
+// The ticks wrap around (after about 4.7 hours on an AVR, or a minute on a
+// Due), but the difference between two readings is right as long as they're
+// less than that apart.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#if !defined(BRICKTRONICS_TIMING_TICKS)
+
+#if defined(__AVR__)
+
+// From the Arduino core (wiring.c)
+extern volatile unsigned long timer0_overflow_count;
+
+static inline uint32_t bricktronicsTimingTicks(void)
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    uint32_t overflows = timer0_overflow_count;
+    uint8_t count = TCNT0;
+    // If the timer just overflowed, the interrupt hasn't counted it yet
+#if defined(TIFR0)
+    if( ( TIFR0 & _BV(TOV0) ) && count < 255 )
+#else
+    if( ( TIFR & _BV(TOV0) ) && count < 255 )
+#endif
+    {
+        overflows++;
+    }
+    SREG = oldSREG;
+    return ( overflows << 8 ) + count;
+}
+
+// A tick is 64 clock cycles. At 16 MHz (or 8, 4...) that's a whole number
+// of microseconds, and this is just a multiply. Otherwise (like at 12 or 20
+// MHz) it divides, split up so multiplying by 64 can't overflow.
+static inline uint32_t bricktronicsTimingTicksToUS(uint32_t ticks)
+{
+    if( 64 % clockCyclesPerMicrosecond() == 0 )
+    {
+        return ticks * ( 64 / clockCyclesPerMicrosecond() );
+    }
+    return ( ticks / clockCyclesPerMicrosecond() ) * 64 + ( ticks % clockCyclesPerMicrosecond() ) * 64 / clockCyclesPerMicrosecond();
+}
+
+#define BRICKTRONICS_TIMING_TICKS()                         bricktronicsTimingTicks()
+#define BRICKTRONICS_TIMING_TICKS_TO_US(ticks)              bricktronicsTimingTicksToUS(ticks)
+
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+
+// The DWT cycle counter, and the debug register that powers it up
+#define BRICKTRONICS_TIMING_DWT_CTRL                        ( *(volatile uint32_t *) 0xE0001000 )
+#define BRICKTRONICS_TIMING_DWT_CYCCNT                      ( *(volatile uint32_t *) 0xE0001004 )
+#define BRICKTRONICS_TIMING_DEMCR                           ( *(volatile uint32_t *) 0xE000EDFC )
+
+static inline uint32_t bricktronicsTimingTicks(void)
+{
+    if( !( BRICKTRONICS_TIMING_DWT_CTRL & 1 ) )
+    {
+        BRICKTRONICS_TIMING_DEMCR |= 0x01000000;
+        BRICKTRONICS_TIMING_DWT_CYCCNT = 0;
+        BRICKTRONICS_TIMING_DWT_CTRL |= 1;
+    }
+    return BRICKTRONICS_TIMING_DWT_CYCCNT;
+}
+
+#define BRICKTRONICS_TIMING_TICKS()                         bricktronicsTimingTicks()
+#define BRICKTRONICS_TIMING_TICKS_TO_US(ticks)              ( (ticks) / ( F_CPU / 1000000UL ) )
+
+#else
+
+#define BRICKTRONICS_TIMING_TICKS()                         ( (uint32_t) micros() )
+#define BRICKTRONICS_TIMING_TICKS_TO_US(ticks)              (ticks)
+
+#endif
+
+#endif // #if !defined(BRICKTRONICS_TIMING_TICKS)
+
+
+// Histogram bins: bin 0 counts values under 16 us, and each bin after that
+// goes up to twice as much as the one before (under 32, 64, ... 1024 us), with
+// everything else in the last bin.
+#define BRICKTRONICS_TIMING_BINS                            8
+#define BRICKTRONICS_TIMING_FIRST_BIN_SHIFT                 4
+
+// A histogram of times, in microseconds, with the smallest, biggest and mean.
+// Values can be negative (the interval jitter is, when the control loop runs
+// a little early), and are binned by their size.
+typedef struct BricktronicsTimingHistogram
+{
+   int32_t min;
+   int32_t max;
+   int64_t total;
+   uint32_t count;
+   uint16_t bins[BRICKTRONICS_TIMING_BINS];
+} BricktronicsTimingHistogram;
+
+class BricktronicsTiming
+{
+    public:
+        static void clear(BricktronicsTimingHistogram *histogram)
+        {
+            histogram->min = 0x7FFFFFFFL;
+            histogram->max = -0x7FFFFFFFL - 1;
+            histogram->total = 0;
+            histogram->count = 0;
+            for( uint8_t i = 0; i < BRICKTRONICS_TIMING_BINS; i++ )
+            {
+                histogram->bins[i] = 0;
+            }
+        }
+
+        static void add(BricktronicsTimingHistogram *histogram, int32_t value)
+        {
+            if( value < histogram->min )
+            {
+                histogram->min = value;
+            }
+            if( value > histogram->max )
+            {
+                histogram->max = value;
+            }
+            histogram->total += value;
+            histogram->count++;
+
+            uint32_t size = ( value < 0 ? -value : value ) >> BRICKTRONICS_TIMING_FIRST_BIN_SHIFT;
+            uint8_t bin = 0;
+            while( size && bin < BRICKTRONICS_TIMING_BINS - 1 )
+            {
+                size >>= 1;
+                bin++;
+            }
+            // The bins stop counting when they're full, instead of wrapping
+            if( histogram->bins[bin] < 0xFFFF )
+            {
+                histogram->bins[bin]++;
+            }
+        }
+
+        // The mean, or 0 if there's nothing in the histogram yet
+        static int32_t mean(const BricktronicsTimingHistogram *histogram)
+        {
+            return histogram->count ? histogram->total / (int32_t) histogram->count : 0;
+        }
+
+        // Prints the count, min, max and mean, then the bins, on one line
+        static void print(Print &output, const BricktronicsTimingHistogram *histogram)
+        {
+            output.print("n:");
+            output.print(histogram->count);
+            if( histogram->count )
+            {
+                output.print(" min:");
+                output.print(histogram->min);
+                output.print(" max:");
+                output.print(histogram->max);
+                output.print(" mean:");
+                output.print(mean(histogram));
+            }
+            output.print(" bins:");
+            for( uint8_t i = 0; i < BRICKTRONICS_TIMING_BINS; i++ )
+            {
+                output.print(' ');
+                output.print(histogram->bins[i]);
+            }
+            output.println();
+        }
+};
+
+#endif // #ifndef BRICKTRONICSTIMING_H
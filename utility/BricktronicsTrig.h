@@ -0,0 +1,223 @@
+/*
+   BricktronicsMotor v1.2 - A software library for LEGO NXT motors.
+
+   Copyright (C) 2015 Adam Wolf, Matthew Beckler, John Baichtal
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; either version 2
+   of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+   Wayne and Layne invests time and resources providing this open-source
+   code, please support W&L and open-source hardware by purchasing products
+   from https://store.wayneandlayne.com/ - Thanks!
+
+   Wayne and Layne, LLC and our products are not connected to or endorsed by the LEGO Group.
+   LEGO, Mindstorms, and NXT are trademarks of the LEGO Group.
+*/
+
+#ifndef BRICKTRONICSTRIG_H
+#define BRICKTRONICSTRIG_H
+
+// Integer trig, for code that runs every update() and can't wait for the
+// floating point sin() and cos() (each takes well over 100 us on an AVR).
+//
+// Angles are "binary angles": a full turn is 65536, so they wrap around on
+// their own when added or subtracted in a uint16_t (16384 is 90 degrees).
+// Results are fractions with 15 fractional bits, so 32767 is (almost) 1.0.
+//
+// Sine comes from a table of a quarter wave, in flash, with a straight line
+// between the entries. That's within 4 (out of 32767) of the real thing.
+//
+// The arctangent uses CORDIC: the vector (x, y) is rotated towards the X
+// axis by smaller and smaller angles (atan(1), atan(1/2), atan(1/4)...),
+// which only takes shifts and adds, and the angles it was rotated by add up
+// to its direction. After 16 steps that's within 1 of the real thing.
+
+#include <stdint.h>
+#if ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#endif
+
+// A full turn, half a turn and a quarter turn, in binary angle units
+#define BRICKTRONICS_TRIG_FULL_TURN                         65536L
+#define BRICKTRONICS_TRIG_HALF_TURN                         32768U
+#define BRICKTRONICS_TRIG_QUARTER_TURN                      16384U
+
+// 1.0 in the results
+#define BRICKTRONICS_TRIG_ONE                               32767
+
+class BricktronicsTrig
+{
+    public:
+        // sin(angle), times 32767
+        static int16_t sine(uint16_t angle)
+        {
+            // Fold the angle into the first quarter turn, and remember the sign
+            uint16_t quarter = angle & ( BRICKTRONICS_TRIG_QUARTER_TURN - 1 );
+            if( angle & BRICKTRONICS_TRIG_QUARTER_TURN )
+            {
+                quarter = BRICKTRONICS_TRIG_QUARTER_TURN - quarter;
+            }
+            int16_t result = _quarterSine(quarter);
+            if( angle & BRICKTRONICS_TRIG_HALF_TURN )
+            {
+                return -result;
+            }
+            return result;
+        }
+
+        // cos(angle), times 32767
+        static int16_t cosine(uint16_t angle)
+        {
+            return sine(angle + BRICKTRONICS_TRIG_QUARTER_TURN);
+        }
+
+        // atan2(y, x), as a binary angle: the direction of the vector (x, y).
+        // Returns 0 for (0, 0).
+        static uint16_t arctan2(int32_t y, int32_t x)
+        {
+            if( x == 0 && y == 0 )
+            {
+                return 0;
+            }
+
+            // Start in the right half, turning the vector around if needed
+            uint32_t angle = 0;
+            if( x < 0 )
+            {
+                angle = (uint32_t) BRICKTRONICS_TRIG_HALF_TURN << 16;
+                x = -x;
+                y = -y;
+            }
+
+            // Scale the vector so the largest part is 2^28 to 2^29. That leaves
+            // room for it to grow (by up to 1.65 times) while being rotated,
+            // and enough bits to keep shifting right for all 16 steps.
+            int32_t largest = max(x, y < 0 ? -y : y);
+            while( largest >= ( 1L << 29 ) )
+            {
+                x >>= 1;
+                y >>= 1;
+                largest >>= 1;
+            }
+            while( largest < ( 1L << 28 ) )
+            {
+                x <<= 1;
+                y <<= 1;
+                largest <<= 1;
+            }
+
+            // atan(2^-i) for each step, as 32-bit binary angles
+            static const uint32_t steps[16] PROGMEM = {
+                 536870912UL,  316933406UL,  167458907UL,   85004756UL,
+                  42667331UL,   21354465UL,   10679838UL,    5340245UL,
+                   2670163UL,    1335087UL,     667544UL,     333772UL,
+                    166886UL,      83443UL,      41722UL,      20861UL,
+            };
+            for( uint8_t i = 0; i < 16; i++ )
+            {
+                int32_t xStep = x >> i;
+                int32_t yStep = y >> i;
+                uint32_t step = pgm_read_dword(&steps[i]);
+                if( y > 0 )
+                {
+                    x += yStep;
+                    y -= xStep;
+                    angle += step;
+                }
+                else
+                {
+                    x -= yStep;
+                    y += xStep;
+                    angle -= step;
+                }
+            }
+            return ( angle + 0x8000 ) >> 16;
+        }
+
+        // The integer square root, rounded down
+        static uint16_t squareRoot(uint32_t value)
+        {
+            uint32_t result = 0;
+            uint32_t bit = 1UL << 30;
+            while( bit > value )
+            {
+                bit >>= 2;
+            }
+            while( bit )
+            {
+                if( value >= result + bit )
+                {
+                    value -= result + bit;
+                    result = ( result >> 1 ) + bit;
+                }
+                else
+                {
+                    result >>= 1;
+                }
+                bit >>= 2;
+            }
+            return result;
+        }
+
+        // Converts between binary angles and whole degrees
+        static uint16_t fromDegrees(int16_t degrees)
+        {
+            // 65536 / 360 = 182.04, the 0.04 is added back in separately
+            int32_t scaled = (int32_t) degrees * 182 + (int32_t) degrees * 4 / 90;
+            return (uint16_t) scaled;
+        }
+        // Returns -180 to 180
+        static int16_t toDegrees(uint16_t angle)
+        {
+            return ( (int32_t) (int16_t) angle * 360 + ( BRICKTRONICS_TRIG_HALF_TURN / 2 ) ) >> 16;
+        }
+
+
+    //private:
+        // We really don't like to hide things inside private,
+        // but if we did, these would be the private items.
+
+        // sin() for 0 to 16384 (a quarter turn)
+        static int16_t _quarterSine(uint16_t angle)
+        {
+            // 64 steps of 256 per quarter turn, plus the end point
+            static const int16_t table[65] PROGMEM = {
+                    0,   804,  1608,  2410,  3212,  4011,  4808,  5602,
+                 6393,  7179,  7962,  8739,  9512, 10278, 11039, 11793,
+                12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+                18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+                23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+                27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+                30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+                32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+                32767,
+            };
+            uint8_t index = angle >> 8;
+            uint8_t fraction = angle & 0xFF;
+            int16_t low = pgm_read_word(&table[index]);
+            if( fraction == 0 )
+            {
+                return low;
+            }
+            int16_t high = pgm_read_word(&table[index + 1]);
+            return low + (int16_t) ( ( (int32_t) ( high - low ) * fraction + 128 ) >> 8 );
+        }
+};
+
+#endif // #ifndef BRICKTRONICSTRIG_H
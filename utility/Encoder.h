@@ -117,6 +117,15 @@ public:
 		encoder.position = p;
 		interrupts();
 	}
+	// Read two encoders at the same instant, in one critical section
+	static inline void readPair(Encoder &a, Encoder &b, int32_t *positionA, int32_t *positionB) {
+		noInterrupts();
+		if (a.interrupts_in_use < 2) update(&a.encoder);
+		if (b.interrupts_in_use < 2) update(&b.encoder);
+		*positionA = a.encoder.position;
+		*positionB = b.encoder.position;
+		interrupts();
+	}
 #else
 	inline int32_t read() {
 		update(&encoder);
@@ -125,6 +134,12 @@ public:
 	inline void write(int32_t p) {
 		encoder.position = p;
 	}
+	static inline void readPair(Encoder &a, Encoder &b, int32_t *positionA, int32_t *positionB) {
+		update(&a.encoder);
+		update(&b.encoder);
+		*positionA = a.encoder.position;
+		*positionB = b.encoder.position;
+	}
 #endif
 private:
 	Encoder_internal_state_t encoder;
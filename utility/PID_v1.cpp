@@ -99,6 +99,27 @@ void PID::SetTunings(double Kp, double Ki, double Kd)
    }
 }
   
+/* SetScaledTunings(...)*******************************************************
+ * Same as SetTunings, but the caller has already done the sample time scaling
+ * (Ki * SampleTimeInSec, Kd / SampleTimeInSec), which lets gain schedules
+ * precompute it instead of dividing every time the tunings change.
+ ******************************************************************************/
+void PID::SetScaledTunings(double Kp, double Ki, double Kd)
+{
+   if (Kp<0 || Ki<0 || Kd<0) return;
+
+   kp = Kp;
+   ki = Ki;
+   kd = Kd;
+
+  if(controllerDirection ==REVERSE)
+   {
+      kp = (0 - kp);
+      ki = (0 - ki);
+      kd = (0 - kd);
+   }
+}
+
 /* SetSampleTime(...) *********************************************************
  * sets the period, in Milliseconds, at which the calculation is performed	
  ******************************************************************************/
@@ -192,4 +213,5 @@ double PID::GetKi(){ return  dispKi;}
 double PID::GetKd(){ return  dispKd;}
 int PID::GetMode(){ return  inAuto ? AUTOMATIC : MANUAL;}
 int PID::GetDirection(){ return controllerDirection;}
+double PID::GetITerm(){ return ITerm;}
 
@@ -35,6 +35,10 @@ class PID
     void SetTunings(double, double,       // * While most users will set the tunings once in the 
                     double);         	  //   constructor, this function gives the user the option
                                           //   of changing tunings during runtime for Adaptive control
+	void SetScaledTunings(double, double, // * Same as SetTunings, but Ki and Kd have already been
+	                      double);        //   multiplied / divided by the sample time (in seconds).
+	                                      //   skips the divisions when the tunings change every
+	                                      //   sample, for gain scheduling
 	void SetControllerDirection(int);	  // * Sets the Direction, or "Action" of the controller. DIRECT
 										  //   means the output will increase when error is positive. REVERSE
 										  //   means the opposite.  it's very unlikely that this will be needed
@@ -50,6 +54,7 @@ class PID
 	double GetKd();						  // where it's important to know what is actually 
 	int GetMode();						  //  inside the PID.
 	int GetDirection();					  //
+	double GetITerm();					  // the integral term, in output units
 
   private:
 	void Initialize();